@@ -1,15 +1,29 @@
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <chrono>
 #include <cmath>
+#include <cctype>
 #include <cstdint>
 #include <cstdio>
+#include <complex>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <future>
 #include <iostream>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -17,6 +31,28 @@
 #include <omp.h>
 #endif
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <csignal>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define HAVE_POSIX_SOCKETS 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
 // --------------------------- Utility: Timer ---------------------------
 struct Timer
 {
@@ -30,11 +66,45 @@ struct Timer
     }
 };
 
+// Nearest-rank percentile, q in (0, 1]; reorders v.
+static double percentile(std::vector<double> &v, double q)
+{
+    if (v.empty())
+        return 0.0;
+    auto nth = v.begin() + (size_t(std::ceil(q * v.size())) - 1);
+    std::nth_element(v.begin(), nth, v.end());
+    return *nth;
+}
+
 // --------------------------- Params & Types ---------------------------
 enum class FractalType
 {
     Mandelbrot,
-    Julia
+    Julia,
+    BurningShip,
+    Tricorn,
+    Multibrot // z^power + c
+};
+
+// Multibrot degrees with a compiled kernel.
+static constexpr int MultibrotMinPower = 2;
+static constexpr int MultibrotMaxPower = 8;
+
+enum class DeepMode
+{
+    Auto,
+    On,
+    Off
+};
+
+// Scalar type the escape-time kernels iterate in. Auto picks the cheapest
+// tier that resolves the frame's pixel spacing (see choose_precision).
+enum class Precision
+{
+    Auto,
+    Float,
+    Double,
+    DoubleDouble
 };
 
 struct FractalParams
@@ -48,6 +118,22 @@ struct FractalParams
     FractalType type = FractalType::Mandelbrot;
     double juliaRe = -0.8;
     double juliaIm = 0.156;
+    int power = 3; // Multibrot degree
+    // Exact decimal centre for deep zooms; empty means use centerX/centerY.
+    std::string centerXStr, centerYStr;
+    DeepMode deep = DeepMode::Auto;
+    bool series = true; // series approximation skip in deep mode
+    bool interiorChecks = true; // cardioid/bulb tests and cycle detection
+    Precision precision = Precision::Auto;
+
+    // Window into a larger view: this render covers pixels [originX, originX +
+    // width) x [originY, originY + height) of a frameWidth x frameHeight frame.
+    // A frame size of 0 means the window is the whole frame.
+    int frameWidth = 0, frameHeight = 0;
+    int originX = 0, originY = 0;
+
+    int full_width() const { return frameWidth > 0 ? frameWidth : width; }
+    int full_height() const { return frameHeight > 0 ? frameHeight : height; }
 };
 
 // --------------------------- Color Helpers & Palettes ---------------------------
@@ -157,14 +243,22 @@ struct ColorMap
     std::vector<int> widths; // band widths (banded)
     double feather = 1.0;    // 0..1, 1 = fully smooth
 
+    // Compiled lookup table: final RGB (0..255, after HSV tweaks, feathering
+    // and band layout) sampled at LutSize + 1 evenly spaced t in [0,1].
+    // Built by compile(); until then colorize() evaluates the palette directly.
+    static constexpr int LutSize = 16384;
+    std::vector<float> lut;
+
     // Built-in gradients
-    static std::vector<RGB> palette_original()
+    static const std::vector<RGB> &palette_original()
     { // blue -> yellow (screenshot-like)
-        return {{0.02, 0.05, 0.35}, {0.02, 0.2, 0.7}, {0.1, 0.6, 0.9}, {0.95, 0.9, 0.1}, {1.0, 1.0, 0.9}};
+        static const std::vector<RGB> pal{{0.02, 0.05, 0.35}, {0.02, 0.2, 0.7}, {0.1, 0.6, 0.9}, {0.95, 0.9, 0.1}, {1.0, 1.0, 0.9}};
+        return pal;
     }
-    static std::vector<RGB> palette_fire()
+    static const std::vector<RGB> &palette_fire()
     { // black -> red -> orange -> yellow -> white
-        return {{0, 0, 0}, {0.3, 0.0, 0.0}, {0.8, 0.2, 0.0}, {1.0, 0.7, 0.0}, {1.0, 1.0, 0.8}};
+        static const std::vector<RGB> pal{{0, 0, 0}, {0.3, 0.0, 0.0}, {0.8, 0.2, 0.0}, {1.0, 0.7, 0.0}, {1.0, 1.0, 0.8}};
+        return pal;
     }
 
     // utility: apply HSV tweaks
@@ -200,6 +294,20 @@ struct ColorMap
         hsv_to_rgb(H, S, V, r, g, b);
     }
 
+    // Samples the palette into `lut`. Call again after changing any field.
+    void compile()
+    {
+        lut.resize(size_t(LutSize + 1) * 3);
+        for (int k = 0; k <= LutSize; ++k)
+        {
+            uint8_t r, g, b;
+            color_at(double(k) / LutSize, r, g, b);
+            lut[size_t(k) * 3 + 0] = r;
+            lut[size_t(k) * 3 + 1] = g;
+            lut[size_t(k) * 3 + 2] = b;
+        }
+    }
+
     // core
     void colorize(double smoothIter, int maxIter, uint8_t &r, uint8_t &g, uint8_t &b) const
     {
@@ -209,7 +317,24 @@ struct ColorMap
             return;
         } // inside set
 
-        double t = smoothIter / maxIter; // 0..1
+        double t = std::clamp(smoothIter / maxIter, 0.0, 1.0); // 0..1
+        if (lut.empty())
+        {
+            color_at(t, r, g, b);
+            return;
+        }
+        float u = float(t) * LutSize;
+        int k = std::min((int)u, LutSize - 1);
+        float f = u - float(k);
+        const float *e = &lut[size_t(k) * 3];
+        r = (uint8_t)(e[0] + (e[3] - e[0]) * f + 0.5f);
+        g = (uint8_t)(e[1] + (e[4] - e[1]) * f + 0.5f);
+        b = (uint8_t)(e[2] + (e[5] - e[2]) * f + 0.5f);
+    }
+
+    // Exact palette evaluation at t in [0,1] (outside-set colours only).
+    void color_at(double t, uint8_t &r, uint8_t &g, uint8_t &b) const
+    {
         switch (type)
         {
         case PaletteType::Smooth:
@@ -275,26 +400,24 @@ struct ColorMap
             }
             // cycle across total width
             int n = (int)stops.size();
-            std::vector<int> W = widths;
-            if ((int)W.size() != n)
-            {
-                W.assign(n, 12);
-            }
+            const bool custom = (int)widths.size() == n;
+            auto width = [&](int k)
+            { return custom ? std::max(1, widths[k]) : 12; };
             int total = 0;
-            for (int w : W)
-                total += std::max(1, w);
+            for (int k = 0; k < n; ++k)
+                total += width(k);
             double tcyc = t * total;
             int acc = 0, k = 0;
             for (; k < n; ++k)
             {
-                int w = std::max(1, W[k]);
+                int w = width(k);
                 if (tcyc < acc + w)
                     break;
                 acc += w;
             }
             int i = k % n, j = (i + 1) % n;
             double local = tcyc - acc;
-            double w = std::max(1, W[i]);
+            double w = width(i);
             double alpha = std::clamp(local / w, 0.0, 1.0);
             // feather controls transition softness
             double blend = (feather <= 0) ? (alpha < 0.5 ? 0.0 : 1.0) : std::pow(alpha, 1.0 / feather);
@@ -307,577 +430,7102 @@ struct ColorMap
     }
 };
 
-// --------------------------- Fractal Generators ---------------------------
-struct IFractal
+// --------------------------- Double-Double Arithmetic ---------------------------
+// Unevaluated sum hi + lo of two doubles, ~106 significant bits. Built on the
+// error-free transforms two_sum (Knuth) and two_prod (one fma).
+struct DoubleDouble
 {
-    virtual ~IFractal() = default;
-    virtual double eval_smooth(double cr, double ci, int maxIter) const = 0;
-};
+    double hi = 0.0, lo = 0.0;
 
-struct Mandelbrot : IFractal
-{
-    double eval_smooth(double cr, double ci, int maxIter) const override
+    DoubleDouble() = default;
+    DoubleDouble(double h) : hi(h) {}
+    DoubleDouble(double h, double l) : hi(h), lo(l) {}
+
+    // -ffast-math may reassociate the rounding-error terms below down to zero;
+    // every intermediate goes through an empty asm that hides its value.
+    static inline double opaque(double x)
     {
-        double zr = 0.0, zi = 0.0;
-        int i = 0;
-        double zr2 = 0.0, zi2 = 0.0;
-        for (; i < maxIter && (zr2 + zi2) <= 4.0; ++i)
-        {
-            zi = 2.0 * zr * zi + ci;
-            zr = zr2 - zi2 + cr;
-            zr2 = zr * zr;
-            zi2 = zi * zi;
-        }
-        if (i >= maxIter)
-            return (double)maxIter;
-        // Smooth coloring (normalized iteration count)
-        double mag = std::sqrt(zr2 + zi2);
-        double nu = std::log2(std::log(mag));
-        return i + 1 - nu;
+#if defined(HAVE_X86_SIMD)
+        asm("" : "+x"(x));
+#elif defined(__GNUC__)
+        asm("" : "+g"(x));
+#endif
+        return x;
     }
-};
 
-struct Julia : IFractal
-{
-    double cRe, cIm;
-    explicit Julia(double cre, double cim) : cRe(cre), cIm(cim) {}
-    double eval_smooth(double zr, double zi, int maxIter) const override
+    static inline DoubleDouble two_sum(double a, double b)
     {
-        int i = 0;
-        double zr2 = zr * zr, zi2 = zi * zi;
-        for (; i < maxIter && (zr2 + zi2) <= 4.0; ++i)
-        {
-            double nzr = zr2 - zi2 + cRe;
-            double nzi = 2.0 * zr * zi + cIm;
-            zr = nzr;
-            zi = nzi;
-            zr2 = zr * zr;
-            zi2 = zi * zi;
-        }
-        if (i >= maxIter)
-            return (double)maxIter;
-        double mag = std::sqrt(zr2 + zi2);
-        double nu = std::log2(std::log(mag));
-        return i + 1 - nu;
+        double s = opaque(a + b);
+        double v = opaque(s - a);
+        return {s, opaque(a - opaque(s - v)) + opaque(b - v)};
     }
-};
 
-// --------------------------- Image (24-bit BMP) ---------------------------
-struct ImageRGB
-{
-    int w, h;
-    std::vector<uint8_t> data; // row-major, 3 bytes/pixel (RGB)
+    static inline DoubleDouble quick_two_sum(double a, double b)
+    {
+        double s = opaque(a + b);
+        return {s, b - opaque(s - a)};
+    }
 
-    ImageRGB(int width, int height) : w(width), h(height), data(size_t(width) * height * 3u) {}
+    friend inline DoubleDouble operator+(const DoubleDouble &a, const DoubleDouble &b)
+    {
+        DoubleDouble s = two_sum(a.hi, b.hi), t = two_sum(a.lo, b.lo);
+        s = quick_two_sum(s.hi, s.lo + t.hi);
+        return quick_two_sum(s.hi, s.lo + t.lo);
+    }
 
-    uint8_t *pixel_ptr(int x, int y) { return &data[(size_t(y) * w + x) * 3u]; }
+    DoubleDouble operator-() const { return {-hi, -lo}; }
+    friend inline DoubleDouble operator-(const DoubleDouble &a, const DoubleDouble &b) { return a + (-b); }
 
-    bool save_bmp(const std::string &path) const
+    friend inline DoubleDouble operator*(const DoubleDouble &a, const DoubleDouble &b)
     {
-        // BMP 24-bit, BGR, bottom-up rows, padded to 4B
-        int rowSize = ((24 * w + 31) / 32) * 4;
-        int imgSize = rowSize * h;
-        int fileSize = 54 + imgSize;
+        double p = opaque(a.hi * b.hi);
+        double e = std::fma(a.hi, b.hi, -p);
+        e += a.hi * b.lo + a.lo * b.hi;
+        return quick_two_sum(p, e);
+    }
+};
 
-        std::vector<uint8_t> file(size_t(fileSize), 0);
+static inline double to_double(float v) { return v; }
+static inline double to_double(double v) { return v; }
+static inline double to_double(const DoubleDouble &v) { return v.hi; }
 
-        // BITMAPFILEHEADER (14 bytes)
-        file[0] = 'B';
-        file[1] = 'M';
-        auto put32 = [&](int offset, uint32_t v)
-        {
-            file[offset + 0] = (uint8_t)(v & 0xFF);
-            file[offset + 1] = (uint8_t)((v >> 8) & 0xFF);
-            file[offset + 2] = (uint8_t)((v >> 16) & 0xFF);
-            file[offset + 3] = (uint8_t)((v >> 24) & 0xFF);
-        };
-        put32(2, (uint32_t)fileSize);
-        put32(10, 54); // pixel data offset
+// --------------------------- Fractal Formulas ---------------------------
+// Every formula iterates z <- f(z) + c and is a compile-time type, so the
+// kernels below are instantiated per formula with the step inlined into the
+// loop; CPURenderer picks the instantiation once per frame. Julia starts z at
+// the pixel with a fixed c, the others start at z = 0 with c = pixel.
+struct MandelbrotFormula
+{
+    static constexpr int Degree = 2;
+    static constexpr bool Julia = false;
+    static constexpr bool Fold = false;      // Burning Ship: |Re z| + i|Im z| before squaring
+    static constexpr bool Conjugate = false; // Tricorn: conj(z) before squaring
+    static constexpr bool Cardioid = true;   // closed-form cardioid/bulb interior test applies
+};
 
-        // BITMAPINFOHEADER (40 bytes)
-        put32(14, 40);
-        put32(18, (uint32_t)w);
-        put32(22, (uint32_t)h);
-        file[26] = 1;
-        file[27] = 0; // planes
-        file[28] = 24;
-        file[29] = 0; // bpp
-        put32(34, (uint32_t)imgSize);
+struct JuliaFormula : MandelbrotFormula
+{
+    static constexpr bool Julia = true;
+    static constexpr bool Cardioid = false;
+};
 
-        // Pixel data (bottom-up)
-        int pad = rowSize - w * 3;
-        size_t dst = 54;
-        for (int y = h - 1; y >= 0; --y)
-        {
-            for (int x = 0; x < w; ++x)
-            {
-                const uint8_t *p = &data[(size_t(y) * w + x) * 3u];
-                file[dst++] = p[2]; // B
-                file[dst++] = p[1]; // G
-                file[dst++] = p[0]; // R
-            }
-            for (int i = 0; i < pad; ++i)
-                file[dst++] = 0;
-        }
+struct BurningShipFormula : MandelbrotFormula
+{
+    static constexpr bool Fold = true;
+    static constexpr bool Cardioid = false;
+};
 
-        FILE *f = std::fopen(path.c_str(), "wb");
-        if (!f)
-            return false;
-        size_t written = std::fwrite(file.data(), 1, file.size(), f);
-        std::fclose(f);
-        return written == file.size();
-    }
+struct TricornFormula : MandelbrotFormula
+{
+    static constexpr bool Conjugate = true;
+    static constexpr bool Cardioid = false;
 };
 
-// --------------------------- Coordinate Mapper ---------------------------
-struct PlaneMapper
+template <int D>
+struct MultibrotFormula : MandelbrotFormula
 {
-    double xMin, xMax, yMin, yMax;
-    int width, height;
-    PlaneMapper(const FractalParams &p) : width(p.width), height(p.height)
+    static constexpr int Degree = D;
+    static constexpr bool Cardioid = false;
+};
+
+static inline float abs_value(float v) { return std::fabs(v); }
+static inline double abs_value(double v) { return std::fabs(v); }
+static inline DoubleDouble abs_value(const DoubleDouble &v) { return v.hi < 0.0 ? -v : v; }
+
+// One step of formula F; zr2/zi2 are the squares of the incoming z.
+template <class F, typename T>
+static inline void formula_step(T &zr, T &zi, T zr2, T zi2, T cr, T ci)
+{
+    if constexpr (F::Degree == 2)
     {
-        double aspect = double(p.width) / double(p.height);
-        xMin = p.centerX - p.scale;
-        xMax = p.centerX + p.scale;
-        double halfY = p.scale / aspect;
-        yMin = p.centerY - halfY;
-        yMax = p.centerY + halfY;
+        if constexpr (F::Fold)
+            zi = T(2.0) * abs_value(zr * zi) + ci;
+        else if constexpr (F::Conjugate)
+            zi = ci - T(2.0) * zr * zi;
+        else
+            zi = T(2.0) * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
     }
-    inline void pixel_to_complex(int x, int y, double &cr, double &ci) const
+    else
     {
-        cr = xMin + (xMax - xMin) * (double(x) / double(width - 1));
-        ci = yMax - (yMax - yMin) * (double(y) / double(height - 1)); // top->bottom
+        // z^Degree by Degree - 1 complex products, unrolled at compile time
+        T pr = zr, pi = zi;
+        for (int d = 1; d < F::Degree; ++d)
+        {
+            T t = pr * zr - pi * zi;
+            pi = pr * zi + pi * zr;
+            pr = t;
+        }
+        zr = pr + cr;
+        zi = pi + ci;
     }
-};
+}
 
-// --------------------------- CPU Renderer ---------------------------
-enum class Backend
-{
-    Auto,
-    Omp,
-    Threads,
-    Serial
-};
+// Orbits are checked for attracting cycles Brent-style: z is saved at
+// power-of-two checkpoints and a return to within PeriodTolerance of the saved
+// point means the orbit is periodic and will never escape. The tolerance is
+// about a thousand ulps at |z| ~ 1 in double. In float that margin (1e-4)
+// also caught slowly escaping orbits near the boundary, so float asks for
+// about one ulp; float orbits in a cycle settle onto it exactly.
+static constexpr double PeriodTolerance = 1e-13;
+static constexpr float PeriodToleranceFloat = 1e-7f;
+static constexpr int PeriodFirstCheckpoint = 8;
 
-struct CPURenderer
+template <typename T>
+static constexpr double period_tolerance() { return std::is_same_v<T, float> ? PeriodToleranceFloat : PeriodTolerance; }
+
+// Closed-form interior test for the main cardioid and the period-2 bulb.
+static inline bool in_cardioid_or_bulb(double cr, double ci)
 {
-    const IFractal &fractal;
-    const FractalParams &params;
-    const ColorMap &cmap;
-    PlaneMapper mapper;
+    double xr = cr - 0.25, ci2 = ci * ci;
+    double q = xr * xr + ci2;
+    if (q * (q + xr) <= 0.25 * ci2)
+        return true;
+    double xb = cr + 1.0;
+    return xb * xb + ci2 <= 0.0625;
+}
 
-    CPURenderer(const IFractal &f, const FractalParams &p, const ColorMap &c)
-        : fractal(f), params(p), cmap(c), mapper(p) {}
+// Normalized iteration count from the escape iteration and final |z|^2;
+// log|z| grows by a factor of Degree per step near escape.
+template <int Degree = 2>
+static inline double smooth_from_escape(int i, double mag2, int maxIter)
+{
+    if (i >= maxIter)
+        return (double)maxIter;
+    double nu;
+    if constexpr (Degree == 2)
+        nu = std::log2(std::log(std::sqrt(mag2)));
+    else
+        nu = std::log(std::log(std::sqrt(mag2))) / std::log(double(Degree));
+    return i + 1 - nu;
+}
 
-    void render_serial(ImageRGB &img) const
+// Escape-time loop shared by every formula and precision tier: z starts at
+// (zr, zi) and iterates formula F.
+template <class F, typename T>
+static double escape_smooth(T zr, T zi, T cr, T ci, int maxIter, bool checks, uint64_t &iters)
+{
+    if (F::Cardioid && checks && in_cardioid_or_bulb(to_double(cr), to_double(ci)))
+        return (double)maxIter;
+    const double tol = period_tolerance<T>();
+    T zr2 = zr * zr, zi2 = zi * zi;
+    T sr = zr, si = zi;
+    int window = PeriodFirstCheckpoint, k = 0;
+    int i = 0;
+    for (; i < maxIter && to_double(zr2 + zi2) <= 4.0; ++i)
     {
-        for (int y = 0; y < params.height; ++y)
+        formula_step<F>(zr, zi, zr2, zi2, cr, ci);
+        zr2 = zr * zr;
+        zi2 = zi * zi;
+        if (checks)
         {
-            for (int x = 0; x < params.width; ++x)
+            if (std::fabs(to_double(zr - sr)) < tol && std::fabs(to_double(zi - si)) < tol)
             {
-                double cr, ci;
-                mapper.pixel_to_complex(x, y, cr, ci);
-                double s = (params.type == FractalType::Mandelbrot)
-                               ? fractal.eval_smooth(cr, ci, params.maxIter)
-                               : fractal.eval_smooth(cr, ci, params.maxIter); // same call
-                uint8_t r, g, b;
-                cmap.colorize(s, params.maxIter, r, g, b);
-                uint8_t *p = img.pixel_ptr(x, y);
-                p[0] = r;
-                p[1] = g;
-                p[2] = b;
+                iters += i + 1;
+                return (double)maxIter;
+            }
+            if (++k == window)
+            {
+                k = 0;
+                window *= 2;
+                sr = zr;
+                si = zi;
             }
         }
     }
+    iters += i;
+    return smooth_from_escape<F::Degree>(i, to_double(zr2 + zi2), maxIter);
+}
 
-#ifdef _OPENMP
-    void render_omp(ImageRGB &img, int threads) const
+// Exterior distance estimation. Only holomorphic formulas (not Fold or
+// Conjugate) have a complex derivative: dz/dc, or dz/dz0 for Julia.
+template <class F>
+static constexpr bool has_distance_estimate() { return !F::Fold && !F::Conjugate; }
+
+struct DistanceSample
+{
+    double smooth;         // as escape_smooth
+    double distance;       // |z| ln|z| / |dz| past DistanceBailout, complex units; 0 = interior
+    double gradRe, gradIm; // d smooth / d Re(pixel), d smooth / d Im(pixel)
+    double band;           // first-order radius keeping the same escape iteration
+};
+
+// |z| at which the distance is read. At the escape radius of 2 the estimate
+// is far off; a few more iterations make it accurate.
+static constexpr double DistanceBailout = 1e4;
+
+// escape_smooth with the derivative carried along in double. The orbit is
+// iterated as there, so `smooth` is the same value up to how the compiler
+// orders the arithmetic (-ffast-math); near the set that can change the
+// escape iteration, which is why distance mode never keeps it for pixels it
+// renders one by one. The smooth count
+// is i + 1 - log_D(ln|z|), and ln|z| = Re log z with (log z)' = dz / z,
+// which gives its gradient at escape. That gradient only holds within the
+// escape band (the smooth count jumps slightly between bands at radius 2), so
+// `band` bounds how far |z| at escape stays above 2 and |z| one step before
+// stays below it. The orbit then continues (in double) to DistanceBailout for
+// the distance.
+template <class F>
+static inline void derivative_step(double &dr, double &di, double zr, double zi)
+{
+    // dz <- Degree z^(Degree-1) dz (+ 1 unless Julia), from the incoming z
+    double pr = zr, pi = zi;
+    for (int d = 2; d < F::Degree; ++d)
     {
-#pragma omp parallel for schedule(dynamic, 4) num_threads(threads)
-        for (int y = 0; y < params.height; ++y)
+        double t = pr * zr - pi * zi;
+        pi = pr * zi + pi * zr;
+        pr = t;
+    }
+    double t = F::Degree * (pr * dr - pi * di) + (F::Julia ? 0.0 : 1.0);
+    di = F::Degree * (pr * di + pi * dr);
+    dr = t;
+}
+
+template <class F, typename T>
+static DistanceSample escape_distance(T zr, T zi, T cr, T ci, int maxIter, bool checks, uint64_t &iters)
+{
+    DistanceSample out{(double)maxIter, 0.0, 0.0, 0.0, 0.0};
+    if (F::Cardioid && checks && in_cardioid_or_bulb(to_double(cr), to_double(ci)))
+        return out;
+    const double tol = period_tolerance<T>();
+    T zr2 = zr * zr, zi2 = zi * zi;
+    T sr = zr, si = zi;
+    double dr = F::Julia ? 1.0 : 0.0, di = 0.0;
+    double lastR = 0.0, lastI = 0.0, lastDr = 0.0, lastDi = 0.0; // z and dz before the last step
+    int window = PeriodFirstCheckpoint, k = 0;
+    int i = 0;
+    for (; i < maxIter && to_double(zr2 + zi2) <= 4.0; ++i)
+    {
+        lastR = to_double(zr);
+        lastI = to_double(zi);
+        lastDr = dr;
+        lastDi = di;
+        derivative_step<F>(dr, di, lastR, lastI);
+        formula_step<F>(zr, zi, zr2, zi2, cr, ci);
+        zr2 = zr * zr;
+        zi2 = zi * zi;
+        if (checks)
         {
-            for (int x = 0; x < params.width; ++x)
+            if (std::fabs(to_double(zr - sr)) < tol && std::fabs(to_double(zi - si)) < tol)
             {
-                double cr, ci;
-                mapper.pixel_to_complex(x, y, cr, ci);
-                double s = fractal.eval_smooth(cr, ci, params.maxIter);
-                uint8_t r, g, b;
-                cmap.colorize(s, params.maxIter, r, g, b);
-                uint8_t *p = img.pixel_ptr(x, y);
-                p[0] = r;
-                p[1] = g;
-                p[2] = b;
+                iters += i + 1;
+                return out;
+            }
+            if (++k == window)
+            {
+                k = 0;
+                window *= 2;
+                sr = zr;
+                si = zi;
             }
         }
     }
-#endif
+    iters += i;
+    if (i >= maxIter)
+        return out;
+    double xr = to_double(zr), xi = to_double(zi), mag2 = to_double(zr2 + zi2);
+    out.smooth = smooth_from_escape<F::Degree>(i, mag2, maxIter);
+    const double qr = (dr * xr + di * xi) / mag2, qi = (di * xr - dr * xi) / mag2; // dz / z
+    const double g = -1.0 / (std::log(double(F::Degree)) * std::log(std::sqrt(mag2)));
+    out.gradRe = g * qr;
+    out.gradIm = -g * qi;
+    out.band = (std::sqrt(mag2) - 2.0) / std::hypot(dr, di);
+    if (i > 0)
+        out.band = std::min(out.band, (2.0 - std::hypot(lastR, lastI)) / std::hypot(lastDr, lastDi));
 
-    void render_threads(ImageRGB &img, int threads) const
+    const double pr = to_double(cr), pi = to_double(ci);
+    for (; mag2 <= DistanceBailout * DistanceBailout; ++iters)
     {
-        if (threads <= 1)
-        {
-            render_serial(img);
-            return;
-        }
-        threads = std::max(1, threads);
-        std::vector<std::thread> pool;
-        std::atomic<int> nextRow{0};
-        auto worker = [&]()
-        {
-            int y;
-            while ((y = nextRow.fetch_add(1)) < params.height)
-            {
-                for (int x = 0; x < params.width; ++x)
-                {
-                    double cr, ci;
-                    mapper.pixel_to_complex(x, y, cr, ci);
-                    double s = fractal.eval_smooth(cr, ci, params.maxIter);
-                    uint8_t r, g, b;
-                    cmap.colorize(s, params.maxIter, r, g, b);
-                    uint8_t *p = img.pixel_ptr(x, y);
-                    p[0] = r;
-                    p[1] = g;
-                    p[2] = b;
-                }
-            }
-        };
-        pool.reserve(threads);
-        for (int i = 0; i < threads; ++i)
-            pool.emplace_back(worker);
-        for (auto &t : pool)
-            t.join();
+        derivative_step<F>(dr, di, xr, xi);
+        double yr = xr * xr, yi = xi * xi;
+        formula_step<F>(xr, xi, yr, yi, pr, pi);
+        mag2 = xr * xr + xi * xi;
     }
+    const double mag = std::sqrt(mag2);
+    out.distance = mag * std::log(mag) / std::hypot(dr, di);
+    return out;
+}
+
+// --------------------------- SIMD Escape-Time Kernel ---------------------------
+// Iterates formula F for a batch of lanes at once. Mandelbrot-style lanes start
+// at z = 0 with c = pixel, Julia lanes start at z = pixel with a shared c; both
+// use the same loop. Escaped lanes are masked out and keep their final z, so the
+// per-lane iteration count and |z|^2 match the scalar kernels to within FMA
+// rounding (the fused multiply-adds round once where the scalar code rounds twice).
+enum class SimdLevel
+{
+    Scalar,
+    AVX2,
+    AVX512
 };
 
-static PaletteType parse_palette(const std::string &s)
+static SimdLevel detect_simd_level()
 {
-    if (s == "smooth")
-        return PaletteType::Smooth;
-    if (s == "original")
-        return PaletteType::Original;
-    if (s == "fire")
-        return PaletteType::Fire;
-    if (s == "bw")
-        return PaletteType::BW;
-    if (s == "gradient")
-        return PaletteType::Gradient;
-    if (s == "banded")
-        return PaletteType::Banded;
-    return PaletteType::Smooth;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+#endif
+    return SimdLevel::Scalar;
 }
 
-static void split_csv(const std::string &s, std::vector<std::string> &out)
+// Lanes per register for a scalar of `bytes` (8 = double, 4 = float).
+static inline int simd_lanes(SimdLevel l, int bytes = 8)
 {
-    out.clear();
-    size_t i = 0;
-    while (i < s.size())
+    switch (l)
     {
-        size_t j = s.find(',', i);
-        if (j == std::string::npos)
-        {
-            out.push_back(s.substr(i));
-            break;
-        }
-        out.push_back(s.substr(i, j - i));
-        i = j + 1;
+    case SimdLevel::AVX512:
+        return 64 / bytes;
+    case SimdLevel::AVX2:
+        return 32 / bytes;
+    default:
+        return 1;
     }
 }
 
-// --------------------------- CLI Parsing ---------------------------
-static bool parse_int(const char *s, int &out)
-{
-    char *e = nullptr;
-    long v = strtol(s, &e, 10);
-    if (!s || *e)
-        return false;
-    out = (int)v;
-    return true;
-}
-static bool parse_double(const char *s, double &out)
+static const char *simd_name(SimdLevel l)
 {
-    char *e = nullptr;
-    double v = strtod(s, &e);
-    if (!s || *e)
-        return false;
-    out = v;
-    return true;
+    switch (l)
+    {
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
 }
 
-struct Options
+// One 512-bit register of lanes: 8 doubles or 16 floats.
+template <typename T>
+struct EscapeBatch
 {
-    FractalParams p;
-    Backend backend = Backend::Auto;
-    int threads = std::max(1u, std::thread::hardware_concurrency());
-    std::string out = "fractal.bmp";
-
-    PaletteType palette = PaletteType::Smooth;
-    std::vector<RGB> colors; // for gradient/banded
-    std::vector<int> widths; // for banded
-    double feather = 1.0;
-    double hue_off = 0.0, sat = 1.0, val = 1.0;
+    static constexpr int MaxLanes = 64 / sizeof(T);
+    alignas(64) T zr[MaxLanes], zi[MaxLanes]; // starting z
+    alignas(64) T cr[MaxLanes], ci[MaxLanes]; // per-lane c
+    alignas(64) T mag2[MaxLanes];             // out: final |z|^2
+    int iters[MaxLanes];                      // out: escape iteration (maxIter = interior)
+    int steps[MaxLanes];                      // out: iterations actually run
 };
 
-static Backend parse_backend(const std::string &s)
+// With `checks`, Mandelbrot lanes inside the cardioid/bulb never start and
+// lanes caught in an attracting cycle (see PeriodTolerance) leave early.
+template <class F, typename T>
+static void escape_batch_scalar(EscapeBatch<T> &b, int lanes, int maxIter, bool checks)
 {
-    if (s == "auto")
-        return Backend::Auto;
-    if (s == "omp")
-        return Backend::Omp;
-    if (s == "threads")
-        return Backend::Threads;
-    if (s == "serial")
-        return Backend::Serial;
-    return Backend::Auto;
+    const T tol = T(period_tolerance<T>());
+    for (int l = 0; l < lanes; ++l)
+    {
+        T zr = b.zr[l], zi = b.zi[l];
+        T zr2 = zr * zr, zi2 = zi * zi;
+        T sr = zr, si = zi;
+        int window = PeriodFirstCheckpoint, k = 0;
+        int i = 0;
+        bool cycle = F::Cardioid && checks && in_cardioid_or_bulb(b.cr[l], b.ci[l]);
+        for (; !cycle && i < maxIter && (zr2 + zi2) <= T(4.0); ++i)
+        {
+            formula_step<F>(zr, zi, zr2, zi2, b.cr[l], b.ci[l]);
+            zr2 = zr * zr;
+            zi2 = zi * zi;
+            if (checks)
+            {
+                cycle = std::fabs(zr - sr) < tol && std::fabs(zi - si) < tol;
+                if (++k == window)
+                {
+                    k = 0;
+                    window *= 2;
+                    sr = zr;
+                    si = zi;
+                }
+            }
+        }
+        b.steps[l] = i;
+        b.iters[l] = cycle ? maxIter : i;
+        b.mag2[l] = zr2 + zi2;
+    }
 }
 
-static FractalType parse_type(const std::string &s)
+#ifdef HAVE_X86_SIMD
+template <class F>
+__attribute__((target("avx2,fma"))) static void escape_batch_avx2(EscapeBatch<double> &b, int maxIter, bool checks)
+{
+    const __m256d four = _mm256_set1_pd(4.0), two = _mm256_set1_pd(2.0), one = _mm256_set1_pd(1.0);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d tol = _mm256_set1_pd(PeriodTolerance);
+    __m256d zr = _mm256_load_pd(b.zr), zi = _mm256_load_pd(b.zi);
+    const __m256d cr = _mm256_load_pd(b.cr), ci = _mm256_load_pd(b.ci);
+    __m256d count = _mm256_setzero_pd();
+    __m256d zr2 = _mm256_mul_pd(zr, zr), zi2 = _mm256_mul_pd(zi, zi);
+    __m256d sr = zr, si = zi;
+    __m256d live = _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), cycle = _mm256_setzero_pd();
+    if (F::Cardioid && checks)
+    {
+        // q(q + x - 1/4) <= y^2/4 (cardioid) or (x + 1)^2 + y^2 <= 1/16 (bulb)
+        __m256d xr = _mm256_sub_pd(cr, _mm256_set1_pd(0.25)), ci2 = _mm256_mul_pd(ci, ci);
+        __m256d q = _mm256_fmadd_pd(xr, xr, ci2);
+        __m256d card = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xr)),
+                                     _mm256_mul_pd(_mm256_set1_pd(0.25), ci2), _CMP_LE_OQ);
+        __m256d xb = _mm256_add_pd(cr, one);
+        __m256d bulb = _mm256_cmp_pd(_mm256_fmadd_pd(xb, xb, ci2), _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+        cycle = _mm256_or_pd(card, bulb);
+        live = _mm256_andnot_pd(cycle, live);
+    }
+    int window = PeriodFirstCheckpoint, k = 0;
+    for (int i = 0; i < maxIter; ++i)
+    {
+        live = _mm256_and_pd(live, _mm256_cmp_pd(_mm256_add_pd(zr2, zi2), four, _CMP_LE_OQ));
+        if (_mm256_movemask_pd(live) == 0)
+            break;
+        count = _mm256_add_pd(count, _mm256_and_pd(live, one));
+        __m256d nzr, nzi;
+        if constexpr (F::Degree == 2)
+        {
+            __m256d zrzi = _mm256_mul_pd(zr, zi);
+            if constexpr (F::Fold)
+                zrzi = _mm256_and_pd(zrzi, absMask);
+            if constexpr (F::Conjugate)
+                nzi = _mm256_fnmadd_pd(two, zrzi, ci);
+            else
+                nzi = _mm256_fmadd_pd(two, zrzi, ci);
+            nzr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+        }
+        else
+        {
+            __m256d pr = zr, pi = zi;
+            for (int d = 1; d < F::Degree; ++d)
+            {
+                __m256d t = _mm256_fmsub_pd(pr, zr, _mm256_mul_pd(pi, zi));
+                pi = _mm256_fmadd_pd(pr, zi, _mm256_mul_pd(pi, zr));
+                pr = t;
+            }
+            nzr = _mm256_add_pd(pr, cr);
+            nzi = _mm256_add_pd(pi, ci);
+        }
+        zr = _mm256_blendv_pd(zr, nzr, live);
+        zi = _mm256_blendv_pd(zi, nzi, live);
+        zr2 = _mm256_mul_pd(zr, zr);
+        zi2 = _mm256_mul_pd(zi, zi);
+        if (checks)
+        {
+            __m256d dr = _mm256_and_pd(_mm256_sub_pd(zr, sr), absMask);
+            __m256d di = _mm256_and_pd(_mm256_sub_pd(zi, si), absMask);
+            __m256d hit = _mm256_and_pd(live, _mm256_and_pd(_mm256_cmp_pd(dr, tol, _CMP_LT_OQ),
+                                                            _mm256_cmp_pd(di, tol, _CMP_LT_OQ)));
+            cycle = _mm256_or_pd(cycle, hit);
+            live = _mm256_andnot_pd(hit, live);
+            if (++k == window)
+            {
+                k = 0;
+                window *= 2;
+                sr = zr;
+                si = zi;
+            }
+        }
+    }
+    _mm256_store_pd(b.mag2, _mm256_add_pd(zr2, zi2));
+    alignas(32) double c[4];
+    _mm256_store_pd(c, count);
+    int cyc = _mm256_movemask_pd(cycle);
+    for (int l = 0; l < 4; ++l)
+    {
+        b.steps[l] = (int)c[l];
+        b.iters[l] = (cyc >> l) & 1 ? maxIter : (int)c[l];
+    }
+}
+
+template <class F>
+__attribute__((target("avx512f"))) static void escape_batch_avx512(EscapeBatch<double> &b, int maxIter, bool checks)
+{
+    const __m512d four = _mm512_set1_pd(4.0), two = _mm512_set1_pd(2.0);
+    const __m512d tol = _mm512_set1_pd(PeriodTolerance);
+    __m512d zr = _mm512_load_pd(b.zr), zi = _mm512_load_pd(b.zi);
+    const __m512d cr = _mm512_load_pd(b.cr), ci = _mm512_load_pd(b.ci);
+    __m512i count = _mm512_setzero_si512();
+    const __m512i oneI = _mm512_set1_epi64(1);
+    __m512d zr2 = _mm512_mul_pd(zr, zr), zi2 = _mm512_mul_pd(zi, zi);
+    __m512d sr = zr, si = zi;
+    __mmask8 live = 0xFF, cycle = 0;
+    if (F::Cardioid && checks)
+    {
+        __m512d xr = _mm512_sub_pd(cr, _mm512_set1_pd(0.25)), ci2 = _mm512_mul_pd(ci, ci);
+        __m512d q = _mm512_fmadd_pd(xr, xr, ci2);
+        __mmask8 card = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xr)),
+                                           _mm512_mul_pd(_mm512_set1_pd(0.25), ci2), _CMP_LE_OQ);
+        __m512d xb = _mm512_add_pd(cr, _mm512_set1_pd(1.0));
+        __mmask8 bulb = _mm512_cmp_pd_mask(_mm512_fmadd_pd(xb, xb, ci2), _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+        cycle = card | bulb;
+        live &= ~cycle;
+    }
+    int window = PeriodFirstCheckpoint, k = 0;
+    for (int i = 0; i < maxIter; ++i)
+    {
+        live &= _mm512_cmp_pd_mask(_mm512_add_pd(zr2, zi2), four, _CMP_LE_OQ);
+        if (!live)
+            break;
+        count = _mm512_mask_add_epi64(count, live, count, oneI);
+        __m512d nzr, nzi;
+        if constexpr (F::Degree == 2)
+        {
+            __m512d zrzi = _mm512_mul_pd(zr, zi);
+            if constexpr (F::Fold)
+                zrzi = _mm512_abs_pd(zrzi);
+            if constexpr (F::Conjugate)
+                nzi = _mm512_fnmadd_pd(two, zrzi, ci);
+            else
+                nzi = _mm512_fmadd_pd(two, zrzi, ci);
+            nzr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+        }
+        else
+        {
+            __m512d pr = zr, pi = zi;
+            for (int d = 1; d < F::Degree; ++d)
+            {
+                __m512d t = _mm512_fmsub_pd(pr, zr, _mm512_mul_pd(pi, zi));
+                pi = _mm512_fmadd_pd(pr, zi, _mm512_mul_pd(pi, zr));
+                pr = t;
+            }
+            nzr = _mm512_add_pd(pr, cr);
+            nzi = _mm512_add_pd(pi, ci);
+        }
+        zr = _mm512_mask_mov_pd(zr, live, nzr);
+        zi = _mm512_mask_mov_pd(zi, live, nzi);
+        zr2 = _mm512_mul_pd(zr, zr);
+        zi2 = _mm512_mul_pd(zi, zi);
+        if (checks)
+        {
+            __mmask8 hit = _mm512_mask_cmp_pd_mask(live, _mm512_abs_pd(_mm512_sub_pd(zr, sr)), tol, _CMP_LT_OQ);
+            hit = _mm512_mask_cmp_pd_mask(hit, _mm512_abs_pd(_mm512_sub_pd(zi, si)), tol, _CMP_LT_OQ);
+            cycle |= hit;
+            live &= ~hit;
+            if (++k == window)
+            {
+                k = 0;
+                window *= 2;
+                sr = zr;
+                si = zi;
+            }
+        }
+    }
+    _mm512_store_pd(b.mag2, _mm512_add_pd(zr2, zi2));
+    alignas(64) int64_t c[8];
+    _mm512_store_si512((void *)c, count);
+    for (int l = 0; l < 8; ++l)
+    {
+        b.steps[l] = (int)c[l];
+        b.iters[l] = (cycle >> l) & 1 ? maxIter : (int)c[l];
+    }
+}
+
+// Float tier: twice the lanes. Counts are kept as integers (the all-ones live
+// mask is -1 per lane) so they stay exact past 2^24 iterations.
+template <class F>
+__attribute__((target("avx2,fma"))) static void escape_batch_avx2(EscapeBatch<float> &b, int maxIter, bool checks)
+{
+    const __m256 four = _mm256_set1_ps(4.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 tol = _mm256_set1_ps(PeriodToleranceFloat);
+    __m256 zr = _mm256_load_ps(b.zr), zi = _mm256_load_ps(b.zi);
+    const __m256 cr = _mm256_load_ps(b.cr), ci = _mm256_load_ps(b.ci);
+    __m256i count = _mm256_setzero_si256();
+    __m256 zr2 = _mm256_mul_ps(zr, zr), zi2 = _mm256_mul_ps(zi, zi);
+    __m256 sr = zr, si = zi;
+    __m256 live = _mm256_castsi256_ps(_mm256_set1_epi32(-1)), cycle = _mm256_setzero_ps();
+    if (F::Cardioid && checks)
+    {
+        __m256 xr = _mm256_sub_ps(cr, _mm256_set1_ps(0.25f)), ci2 = _mm256_mul_ps(ci, ci);
+        __m256 q = _mm256_fmadd_ps(xr, xr, ci2);
+        __m256 card = _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, xr)),
+                                    _mm256_mul_ps(_mm256_set1_ps(0.25f), ci2), _CMP_LE_OQ);
+        __m256 xb = _mm256_add_ps(cr, _mm256_set1_ps(1.0f));
+        __m256 bulb = _mm256_cmp_ps(_mm256_fmadd_ps(xb, xb, ci2), _mm256_set1_ps(0.0625f), _CMP_LE_OQ);
+        cycle = _mm256_or_ps(card, bulb);
+        live = _mm256_andnot_ps(cycle, live);
+    }
+    int window = PeriodFirstCheckpoint, k = 0;
+    for (int i = 0; i < maxIter; ++i)
+    {
+        live = _mm256_and_ps(live, _mm256_cmp_ps(_mm256_add_ps(zr2, zi2), four, _CMP_LE_OQ));
+        if (_mm256_movemask_ps(live) == 0)
+            break;
+        count = _mm256_sub_epi32(count, _mm256_castps_si256(live));
+        __m256 nzr, nzi;
+        if constexpr (F::Degree == 2)
+        {
+            __m256 zrzi = _mm256_mul_ps(zr, zi);
+            if constexpr (F::Fold)
+                zrzi = _mm256_and_ps(zrzi, absMask);
+            if constexpr (F::Conjugate)
+                nzi = _mm256_fnmadd_ps(two, zrzi, ci);
+            else
+                nzi = _mm256_fmadd_ps(two, zrzi, ci);
+            nzr = _mm256_add_ps(_mm256_sub_ps(zr2, zi2), cr);
+        }
+        else
+        {
+            __m256 pr = zr, pi = zi;
+            for (int d = 1; d < F::Degree; ++d)
+            {
+                __m256 t = _mm256_fmsub_ps(pr, zr, _mm256_mul_ps(pi, zi));
+                pi = _mm256_fmadd_ps(pr, zi, _mm256_mul_ps(pi, zr));
+                pr = t;
+            }
+            nzr = _mm256_add_ps(pr, cr);
+            nzi = _mm256_add_ps(pi, ci);
+        }
+        zr = _mm256_blendv_ps(zr, nzr, live);
+        zi = _mm256_blendv_ps(zi, nzi, live);
+        zr2 = _mm256_mul_ps(zr, zr);
+        zi2 = _mm256_mul_ps(zi, zi);
+        if (checks)
+        {
+            __m256 dr = _mm256_and_ps(_mm256_sub_ps(zr, sr), absMask);
+            __m256 di = _mm256_and_ps(_mm256_sub_ps(zi, si), absMask);
+            __m256 hit = _mm256_and_ps(live, _mm256_and_ps(_mm256_cmp_ps(dr, tol, _CMP_LT_OQ),
+                                                         _mm256_cmp_ps(di, tol, _CMP_LT_OQ)));
+            cycle = _mm256_or_ps(cycle, hit);
+            live = _mm256_andnot_ps(hit, live);
+            if (++k == window)
+            {
+                k = 0;
+                window *= 2;
+                sr = zr;
+                si = zi;
+            }
+        }
+    }
+    _mm256_store_ps(b.mag2, _mm256_add_ps(zr2, zi2));
+    alignas(32) int32_t c[8];
+    _mm256_store_si256((__m256i *)c, count);
+    int cyc = _mm256_movemask_ps(cycle);
+    for (int l = 0; l < 8; ++l)
+    {
+        b.steps[l] = c[l];
+        b.iters[l] = (cyc >> l) & 1 ? maxIter : c[l];
+    }
+}
+
+template <class F>
+__attribute__((target("avx512f"))) static void escape_batch_avx512(EscapeBatch<float> &b, int maxIter, bool checks)
+{
+    const __m512 four = _mm512_set1_ps(4.0f), two = _mm512_set1_ps(2.0f);
+    const __m512 tol = _mm512_set1_ps(PeriodToleranceFloat);
+    __m512 zr = _mm512_load_ps(b.zr), zi = _mm512_load_ps(b.zi);
+    const __m512 cr = _mm512_load_ps(b.cr), ci = _mm512_load_ps(b.ci);
+    __m512i count = _mm512_setzero_si512();
+    const __m512i oneI = _mm512_set1_epi32(1);
+    __m512 zr2 = _mm512_mul_ps(zr, zr), zi2 = _mm512_mul_ps(zi, zi);
+    __m512 sr = zr, si = zi;
+    __mmask16 live = 0xFFFF, cycle = 0;
+    if (F::Cardioid && checks)
+    {
+        __m512 xr = _mm512_sub_ps(cr, _mm512_set1_ps(0.25f)), ci2 = _mm512_mul_ps(ci, ci);
+        __m512 q = _mm512_fmadd_ps(xr, xr, ci2);
+        __mmask16 card = _mm512_cmp_ps_mask(_mm512_mul_ps(q, _mm512_add_ps(q, xr)),
+                                            _mm512_mul_ps(_mm512_set1_ps(0.25f), ci2), _CMP_LE_OQ);
+        __m512 xb = _mm512_add_ps(cr, _mm512_set1_ps(1.0f));
+        __mmask16 bulb = _mm512_cmp_ps_mask(_mm512_fmadd_ps(xb, xb, ci2), _mm512_set1_ps(0.0625f), _CMP_LE_OQ);
+        cycle = card | bulb;
+        live &= ~cycle;
+    }
+    int window = PeriodFirstCheckpoint, k = 0;
+    for (int i = 0; i < maxIter; ++i)
+    {
+        live &= _mm512_cmp_ps_mask(_mm512_add_ps(zr2, zi2), four, _CMP_LE_OQ);
+        if (!live)
+            break;
+        count = _mm512_mask_add_epi32(count, live, count, oneI);
+        __m512 nzr, nzi;
+        if constexpr (F::Degree == 2)
+        {
+            __m512 zrzi = _mm512_mul_ps(zr, zi);
+            if constexpr (F::Fold)
+                zrzi = _mm512_abs_ps(zrzi);
+            if constexpr (F::Conjugate)
+                nzi = _mm512_fnmadd_ps(two, zrzi, ci);
+            else
+                nzi = _mm512_fmadd_ps(two, zrzi, ci);
+            nzr = _mm512_add_ps(_mm512_sub_ps(zr2, zi2), cr);
+        }
+        else
+        {
+            __m512 pr = zr, pi = zi;
+            for (int d = 1; d < F::Degree; ++d)
+            {
+                __m512 t = _mm512_fmsub_ps(pr, zr, _mm512_mul_ps(pi, zi));
+                pi = _mm512_fmadd_ps(pr, zi, _mm512_mul_ps(pi, zr));
+                pr = t;
+            }
+            nzr = _mm512_add_ps(pr, cr);
+            nzi = _mm512_add_ps(pi, ci);
+        }
+        zr = _mm512_mask_mov_ps(zr, live, nzr);
+        zi = _mm512_mask_mov_ps(zi, live, nzi);
+        zr2 = _mm512_mul_ps(zr, zr);
+        zi2 = _mm512_mul_ps(zi, zi);
+        if (checks)
+        {
+            __mmask16 hit = _mm512_mask_cmp_ps_mask(live, _mm512_abs_ps(_mm512_sub_ps(zr, sr)), tol, _CMP_LT_OQ);
+            hit = _mm512_mask_cmp_ps_mask(hit, _mm512_abs_ps(_mm512_sub_ps(zi, si)), tol, _CMP_LT_OQ);
+            cycle |= hit;
+            live &= ~hit;
+            if (++k == window)
+            {
+                k = 0;
+                window *= 2;
+                sr = zr;
+                si = zi;
+            }
+        }
+    }
+    _mm512_store_ps(b.mag2, _mm512_add_ps(zr2, zi2));
+    alignas(64) int32_t c[16];
+    _mm512_store_si512((void *)c, count);
+    for (int l = 0; l < 16; ++l)
+    {
+        b.steps[l] = c[l];
+        b.iters[l] = (cycle >> l) & 1 ? maxIter : c[l];
+    }
+}
+#endif
+
+template <class F, typename T>
+static void escape_batch(EscapeBatch<T> &b, SimdLevel level, int maxIter, bool checks)
+{
+#ifdef HAVE_X86_SIMD
+    if (level == SimdLevel::AVX512)
+        return escape_batch_avx512<F>(b, maxIter, checks);
+    if (level == SimdLevel::AVX2)
+        return escape_batch_avx2<F>(b, maxIter, checks);
+#endif
+    escape_batch_scalar<F>(b, simd_lanes(level, sizeof(T)), maxIter, checks);
+}
+
+// Allocator that leaves value-initialised elements untouched, so a buffer's
+// pages are first written (and placed on a NUMA node) by whichever thread
+// fills them rather than by the allocating thread.
+template <typename T>
+struct NoInitAllocator : std::allocator<T>
+{
+    template <typename U>
+    struct rebind
+    {
+        using other = NoInitAllocator<U>;
+    };
+    NoInitAllocator() = default;
+    template <typename U>
+    NoInitAllocator(const NoInitAllocator<U> &) {}
+
+    template <typename U, typename... Args>
+    void construct(U *ptr, Args &&...args)
+    {
+        if constexpr (sizeof...(Args) == 0)
+            ::new ((void *)ptr) U;
+        else
+            ::new ((void *)ptr) U(std::forward<Args>(args)...);
+    }
+};
+
+// --------------------------- Image (24-bit BMP) ---------------------------
+// Pixels are either top-down RGB rows, or (bmpLayout) the BMP pixel array
+// itself: BGR, bottom-up, rows padded to 4 bytes. In BMP layout save_bmp is
+// a header plus one write of `data`; otherwise rows are converted and streamed
+// through a small bounded buffer, never a second full-size copy.
+struct ImageRGB
+{
+    int w, h;
+    bool bmpLayout;
+    size_t stride;                                       // bytes per row in `data`
+    std::vector<uint8_t, NoInitAllocator<uint8_t>> data; // 3 bytes/pixel, order per layout
+    bool untouched;                                      // rows not zeroed yet (NUMA first touch)
+
+    // With firstTouch the rows are left unwritten; the NUMA render zeroes
+    // each row on the node that renders it.
+    ImageRGB(int width, int height, bool bmpNative = false, bool firstTouch = false)
+        : w(width), h(height), bmpLayout(bmpNative),
+          stride(bmpNative ? bmp_row_size(width) : size_t(width) * 3u), data(stride * size_t(height)), untouched(firstTouch)
+    {
+        if (!firstTouch)
+            std::memset(data.data(), 0, data.size());
+    }
+
+    static size_t bmp_row_size(int width) { return ((size_t(24) * width + 31) / 32) * 4; }
+
+    uint8_t *row_ptr(int y) { return &data[(bmpLayout ? size_t(h - 1 - y) : size_t(y)) * stride]; }
+    const uint8_t *row_ptr(int y) const { return &data[(bmpLayout ? size_t(h - 1 - y) : size_t(y)) * stride]; }
+    uint8_t *pixel_ptr(int x, int y) { return row_ptr(y) + size_t(x) * 3u; }
+
+    // Zeroes the BMP padding after row y's pixels (no-op without padding).
+    void clear_padding(int y) { std::memset(row_ptr(y) + size_t(w) * 3u, 0, stride - size_t(w) * 3u); }
+
+    // byte offset of red within a pixel (blue is 2 - red_offset())
+    int red_offset() const { return bmpLayout ? 2 : 0; }
+
+    // BMP 24-bit, BGR, bottom-up rows, padded to 4B. False if the file
+    // would not fit BMP's 32-bit size fields.
+    bool bmp_header(uint8_t (&header)[54]) const
+    {
+        const size_t rowSize = bmp_row_size(w);
+        const uint64_t imgSize = uint64_t(rowSize) * h;
+        const uint64_t fileSize = 54 + imgSize;
+        if (fileSize > 0xFFFFFFFFull)
+            return false;
+
+        std::memset(header, 0, sizeof(header));
+
+        // BITMAPFILEHEADER (14 bytes)
+        header[0] = 'B';
+        header[1] = 'M';
+        auto put32 = [&](int offset, uint32_t v)
+        {
+            header[offset + 0] = (uint8_t)(v & 0xFF);
+            header[offset + 1] = (uint8_t)((v >> 8) & 0xFF);
+            header[offset + 2] = (uint8_t)((v >> 16) & 0xFF);
+            header[offset + 3] = (uint8_t)((v >> 24) & 0xFF);
+        };
+        put32(2, (uint32_t)fileSize);
+        put32(10, 54); // pixel data offset
+
+        // BITMAPINFOHEADER (40 bytes)
+        put32(14, 40);
+        put32(18, (uint32_t)w);
+        put32(22, (uint32_t)h);
+        header[26] = 1;
+        header[27] = 0; // planes
+        header[28] = 24;
+        header[29] = 0; // bpp
+        put32(34, (uint32_t)imgSize);
+        return true;
+    }
+
+    // Row y in BMP pixel order (BGR); the padding bytes are not written.
+    void bmp_row(int y, uint8_t *dst) const
+    {
+        const uint8_t *p = row_ptr(y);
+        if (bmpLayout)
+        {
+            std::memcpy(dst, p, size_t(w) * 3u);
+            return;
+        }
+        for (int x = 0; x < w; ++x, p += 3, dst += 3)
+        {
+            dst[0] = p[2]; // B
+            dst[1] = p[1]; // G
+            dst[2] = p[0]; // R
+        }
+    }
+
+    // The whole BMP file in memory; empty if it is too large for BMP.
+    std::vector<uint8_t> encode_bmp() const
+    {
+        uint8_t header[54];
+        if (!bmp_header(header))
+            return {};
+        const size_t rowSize = bmp_row_size(w);
+        std::vector<uint8_t> out(sizeof(header) + rowSize * h, 0);
+        std::memcpy(out.data(), header, sizeof(header));
+        for (int y = 0; y < h; ++y)
+            bmp_row(y, &out[sizeof(header) + size_t(h - 1 - y) * rowSize]);
+        return out;
+    }
+
+    bool save_bmp(const std::string &path) const
+    {
+        uint8_t header[54];
+        if (!bmp_header(header))
+            return false;
+        const size_t rowSize = bmp_row_size(w);
+
+        FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        bool ok = std::fwrite(header, 1, sizeof(header), f) == sizeof(header);
+        if (bmpLayout)
+        {
+            ok = ok && std::fwrite(data.data(), 1, data.size(), f) == data.size();
+        }
+        else
+        {
+            // Pixel data (bottom-up), a few MB of converted rows per write
+            const size_t rowsPerChunk = std::max<size_t>(1, (size_t(4) << 20) / rowSize);
+            std::vector<uint8_t> buf(std::min<size_t>(rowsPerChunk, size_t(h)) * rowSize, 0);
+            for (int y = h - 1; y >= 0 && ok;)
+            {
+                size_t n = 0;
+                for (; n < rowsPerChunk && y >= 0; ++n, --y)
+                    bmp_row(y, &buf[n * rowSize]);
+                ok = std::fwrite(buf.data(), 1, n * rowSize, f) == n * rowSize;
+            }
+        }
+        return (std::fclose(f) == 0) && ok;
+    }
+};
+
+// Single-channel float image as PFM ("Pf", little-endian, bottom-up rows).
+static bool save_pfm(const std::string &path, int w, int h, const std::vector<float> &v)
+{
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = std::fprintf(f, "Pf\n%d %d\n-1.0\n", w, h) > 0;
+    for (int y = h - 1; y >= 0 && ok; --y)
+        ok = std::fwrite(&v[size_t(y) * w], sizeof(float), size_t(w), f) == size_t(w);
+    return (std::fclose(f) == 0) && ok;
+}
+
+// --------------------------- BigTIFF Strip Writer ---------------------------
+// Uncompressed 8-bit RGB BigTIFF: 64-bit offsets, so there is no 4 GB limit.
+// Strips are appended in order as they arrive and the IFD with the strip
+// table is written at the end, once every strip is on disk.
+class BigTiffWriter
+{
+public:
+    ~BigTiffWriter()
+    {
+        if (f)
+            std::fclose(f);
+    }
+
+    bool open(const std::string &path, int width, int height, int rowsPerStrip)
+    {
+        w = width;
+        h = height;
+        rps = rowsPerStrip;
+        f = std::fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        // "II", version 43, offset size 8, reserved, first IFD (patched in finish)
+        uint8_t header[16] = {'I', 'I', 43, 0, 8, 0, 0, 0};
+        pos = sizeof(header);
+        return std::fwrite(header, 1, sizeof(header), f) == sizeof(header);
+    }
+
+    // Next strip: rps top-down RGB rows (fewer for the last strip).
+    bool write_strip(const uint8_t *rgb, size_t bytes)
+    {
+        offsets.push_back(pos);
+        counts.push_back(bytes);
+        pos += bytes;
+        return std::fwrite(rgb, 1, bytes, f) == bytes;
+    }
+
+    bool finish()
+    {
+        std::vector<uint8_t> tail;
+        auto put = [&](uint64_t v, int bytes)
+        {
+            for (int i = 0; i < bytes; ++i)
+                tail.push_back(uint8_t(v >> (8 * i)));
+        };
+        if (pos & 7)
+            put(0, int(8 - (pos & 7))); // word-align the tables
+        const size_t n = offsets.size();
+        uint64_t offsetsAt = 0, countsAt = 0;
+        if (n > 1)
+        {
+            offsetsAt = pos + tail.size();
+            for (uint64_t o : offsets)
+                put(o, 8);
+            countsAt = pos + tail.size();
+            for (uint64_t c : counts)
+                put(c, 8);
+        }
+        const uint64_t ifdAt = pos + tail.size();
+
+        enum : uint16_t
+        {
+            Short = 3,
+            Long = 4,
+            Long8 = 16
+        };
+        auto entry = [&](uint16_t tag, uint16_t type, uint64_t count, uint64_t value)
+        {
+            put(tag, 2);
+            put(type, 2);
+            put(count, 8);
+            put(value, 8);
+        };
+        const int entries = 10;
+        put(entries, 8);
+        entry(256, Long, 1, uint64_t(w));                             // ImageWidth
+        entry(257, Long, 1, uint64_t(h));                             // ImageLength
+        entry(258, Short, 3, 8ull | (8ull << 16) | (8ull << 32));     // BitsPerSample 8,8,8
+        entry(259, Short, 1, 1);                                      // Compression: none
+        entry(262, Short, 1, 2);                                      // Photometric: RGB
+        entry(273, Long8, n, n > 1 ? offsetsAt : offsets.front());    // StripOffsets
+        entry(277, Short, 1, 3);                                      // SamplesPerPixel
+        entry(278, Long, 1, uint64_t(rps));                           // RowsPerStrip
+        entry(279, Long8, n, n > 1 ? countsAt : counts.front());      // StripByteCounts
+        entry(284, Short, 1, 1);                                      // PlanarConfig: chunky
+        put(0, 8);                                                    // no next IFD
+
+        bool ok = std::fwrite(tail.data(), 1, tail.size(), f) == tail.size();
+        uint8_t first[8];
+        for (int i = 0; i < 8; ++i)
+            first[i] = uint8_t(ifdAt >> (8 * i));
+        ok = ok && std::fseek(f, 8, SEEK_SET) == 0 && std::fwrite(first, 1, 8, f) == 8;
+        ok = (std::fclose(f) == 0) && ok;
+        f = nullptr;
+        return ok;
+    }
+
+    uint64_t bytes_written() const { return pos; }
+
+private:
+    FILE *f = nullptr;
+    int w = 0, h = 0, rps = 0;
+    uint64_t pos = 0;
+    std::vector<uint64_t> offsets, counts;
+};
+
+// --------------------------- Animated GIF Writer ---------------------------
+// GIF89a with one global 6x7x6 colour cube; frames are mapped into it with a
+// 4x4 ordered dither (no per-frame palette search) and LZW-coded with a small
+// hash table that is cheap to reset at every dictionary clear.
+class GifWriter
+{
+public:
+    ~GifWriter()
+    {
+        if (f)
+            std::fclose(f);
+    }
+
+    bool open(const std::string &path, int width, int height, int delayCs)
+    {
+        if (width > 0xFFFF || height > 0xFFFF)
+            return false;
+        w = width;
+        h = height;
+        delay = delayCs;
+        f = std::fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        std::vector<uint8_t> head = {'G', 'I', 'F', '8', '9', 'a'};
+        put16(head, w);
+        put16(head, h);
+        head.insert(head.end(), {0xF7, 0, 0}); // 256-entry global table
+        for (int i = 0; i < 256; ++i)
+        {
+            int r = i / 42, g = (i / 6) % 7, b = i % 6;
+            bool used = i < 252;
+            head.push_back(used ? uint8_t(r * 51) : 0);
+            head.push_back(used ? uint8_t(g * 255 / 6) : 0);
+            head.push_back(used ? uint8_t(b * 51) : 0);
+        }
+        // NETSCAPE2.0 application extension: loop forever
+        const uint8_t loop[] = {0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0};
+        head.insert(head.end(), loop, loop + sizeof(loop));
+        return std::fwrite(head.data(), 1, head.size(), f) == head.size();
+    }
+
+    bool add_frame(const ImageRGB &img)
+    {
+        static const uint8_t bayer[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+        indices.resize(size_t(w) * h);
+        const int ri = img.red_offset(), bi = 2 - ri;
+        for (int y = 0; y < h; ++y)
+        {
+            const uint8_t *p = img.row_ptr(y);
+            uint8_t *dst = &indices[size_t(y) * w];
+            for (int x = 0; x < w; ++x, p += 3)
+            {
+                // threshold in [0, 255): quantise v * (L-1) / 255 with a dithered floor
+                const int d = bayer[y & 3][x & 3] * 16 + 8;
+                const int r = (p[ri] * 5 + d) / 256, g = (p[1] * 6 + d) / 256, b = (p[bi] * 5 + d) / 256;
+                dst[x] = uint8_t(r * 42 + g * 6 + b);
+            }
+        }
+
+        out.clear();
+        // graphic control extension: delay, no disposal, no transparency
+        out.insert(out.end(), {0x21, 0xF9, 4, 0x04});
+        put16(out, delay);
+        out.insert(out.end(), {0, 0});
+        // image descriptor covering the whole screen, no local table
+        out.push_back(0x2C);
+        put16(out, 0);
+        put16(out, 0);
+        put16(out, w);
+        put16(out, h);
+        out.push_back(0);
+        out.push_back(8); // LZW minimum code size
+        lzw_encode();
+        out.push_back(0); // block terminator
+        return std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    }
+
+    bool finish()
+    {
+        bool ok = std::fputc(0x3B, f) != EOF;
+        ok = (std::fclose(f) == 0) && ok;
+        f = nullptr;
+        return ok;
+    }
+
+private:
+    static constexpr int ClearCode = 256, MaxCode = 4095, HashSize = 8192;
+
+    static void put16(std::vector<uint8_t> &v, int x)
+    {
+        v.push_back(uint8_t(x & 0xFF));
+        v.push_back(uint8_t((x >> 8) & 0xFF));
+    }
+
+    // LSB-first bit packing into 255-byte data sub-blocks
+    void put_code(int code, int bits)
+    {
+        acc |= uint32_t(code) << nbits;
+        nbits += bits;
+        while (nbits >= 8)
+        {
+            block[blockLen++] = uint8_t(acc & 0xFF);
+            acc >>= 8;
+            nbits -= 8;
+            if (blockLen == 255)
+                flush_block();
+        }
+    }
+
+    void flush_block()
+    {
+        if (blockLen == 0)
+            return;
+        out.push_back(uint8_t(blockLen));
+        out.insert(out.end(), block, block + blockLen);
+        blockLen = 0;
+    }
+
+    void lzw_encode()
+    {
+        // key = prefix code << 8 | next byte, value = code of that string
+        std::vector<int32_t> keys(HashSize), vals(HashSize);
+        auto reset = [&]
+        { std::fill(keys.begin(), keys.end(), -1); };
+        auto slot = [&](int32_t key)
+        {
+            uint32_t i = (uint32_t(key) * 2654435761u) >> 19;
+            while (keys[i] != -1 && keys[i] != key)
+                i = (i + 1) & (HashSize - 1);
+            return i;
+        };
+
+        reset();
+        acc = 0;
+        nbits = 0;
+        blockLen = 0;
+        int codeSize = 9, next = ClearCode + 1;
+        put_code(ClearCode, codeSize);
+        int cur = indices[0];
+        for (size_t i = 1; i < indices.size(); ++i)
+        {
+            const int32_t key = (cur << 8) | indices[i];
+            const uint32_t at = slot(key);
+            if (keys[at] == key)
+            {
+                cur = vals[at];
+                continue;
+            }
+            put_code(cur, codeSize);
+            keys[at] = key;
+            vals[at] = ++next;
+            if (next >= (1 << codeSize))
+                ++codeSize;
+            if (next == MaxCode)
+            {
+                put_code(ClearCode, codeSize);
+                reset();
+                codeSize = 9;
+                next = ClearCode + 1;
+            }
+            cur = indices[i];
+        }
+        put_code(cur, codeSize);
+        put_code(ClearCode + 1, codeSize); // end of information
+        if (nbits > 0)
+            put_code(0, 8 - nbits);
+        flush_block();
+    }
+
+    FILE *f = nullptr;
+    int w = 0, h = 0, delay = 4;
+    std::vector<uint8_t> indices, out;
+    uint8_t block[255];
+    int blockLen = 0, nbits = 0;
+    uint32_t acc = 0;
+};
+
+// --------------------------- Iteration Field ---------------------------
+// Smooth iteration count per pixel, kept apart from the colours so a frame can
+// be re-colored with a different ColorMap without iterating again.
+struct IterField
+{
+    int w = 0, h = 0;
+    int maxIter = 0;
+    std::vector<float, NoInitAllocator<float>> s; // row-major
+
+    IterField() = default;
+    IterField(int width, int height, int maxIterations)
+        : w(width), h(height), maxIter(maxIterations), s(size_t(width) * height, 0.0f) {}
+
+    // Anti-aliased pixels: aaPixel (ascending pixel indices) with aaCount
+    // subpixel samples each in aaSamples; colorize averages their colours.
+    int aaCount = 0;
+    std::vector<size_t> aaPixel;
+    std::vector<float> aaSamples;
+
+    // View of the last complete full frame, for reuse by the next one: pixel
+    // (x, y) holds the point re0 + x stepRe + i (im0 + y stepIm). `family`
+    // names the other inputs of the values; empty when there is no such frame.
+    struct View
+    {
+        double re0 = 0, im0 = 0, stepRe = 0, stepIm = 0;
+    } view;
+    std::string family;
+
+    float &at(int x, int y) { return s[size_t(y) * w + x]; }
+    float at(int x, int y) const { return s[size_t(y) * w + x]; }
+
+    void clear_aa()
+    {
+        aaCount = 0;
+        aaPixel.clear();
+        aaSamples.clear();
+    }
+};
+
+// --------------------------- Coordinate Mapper ---------------------------
+struct PlaneMapper
+{
+    double xMin, xMax, yMin, yMax;
+    int width, height;   // full frame
+    int originX, originY; // window offset within the frame
+    PlaneMapper(const FractalParams &p)
+        : width(p.full_width()), height(p.full_height()), originX(p.originX), originY(p.originY)
+    {
+        double aspect = double(width) / double(height);
+        xMin = p.centerX - p.scale;
+        xMax = p.centerX + p.scale;
+        double halfY = p.scale / aspect;
+        yMin = p.centerY - halfY;
+        yMax = p.centerY + halfY;
+    }
+    inline void pixel_to_complex(int x, int y, double &cr, double &ci) const
+    {
+        subpixel_to_complex(double(x), double(y), cr, ci);
+    }
+    // Fractional pixel coordinates; integers give the pixel's own point.
+    inline void subpixel_to_complex(double fx, double fy, double &cr, double &ci) const
+    {
+        cr = xMin + (xMax - xMin) * ((fx + originX) / double(width - 1));
+        ci = yMax - (yMax - yMin) * ((fy + originY) / double(height - 1)); // top->bottom
+    }
+};
+
+// --------------------------- Deep Zoom: Multiprecision ---------------------------
+// Signed fixed-point number in 32-bit limbs (least significant first). The top
+// limb is the integer part and the rest is fraction, so a value with n limbs
+// resolves 2^-(32*(n-1)). All operands of one operation share the same size.
+struct BigFixed
+{
+    std::vector<uint32_t> m;
+    bool neg = false;
+
+    BigFixed() = default;
+    explicit BigFixed(int limbs) : m(size_t(std::max(2, limbs)), 0u) {}
+
+    int limbs() const { return (int)m.size(); }
+
+    bool is_zero() const
+    {
+        for (uint32_t v : m)
+            if (v)
+                return false;
+        return true;
+    }
+
+    static int cmp_mag(const BigFixed &a, const BigFixed &b)
+    {
+        for (int i = a.limbs() - 1; i >= 0; --i)
+            if (a.m[i] != b.m[i])
+                return a.m[i] < b.m[i] ? -1 : 1;
+        return 0;
+    }
+
+    // out may alias a or b
+    static void add_mag(const BigFixed &a, const BigFixed &b, BigFixed &out)
+    {
+        uint64_t carry = 0;
+        for (int i = 0; i < a.limbs(); ++i)
+        {
+            uint64_t s = (uint64_t)a.m[i] + b.m[i] + carry;
+            out.m[i] = (uint32_t)s;
+            carry = s >> 32;
+        }
+    }
+
+    // |a| >= |b| required; out may alias a or b
+    static void sub_mag(const BigFixed &a, const BigFixed &b, BigFixed &out)
+    {
+        uint64_t borrow = 0;
+        for (int i = 0; i < a.limbs(); ++i)
+        {
+            uint64_t d = (uint64_t)a.m[i] - b.m[i] - borrow;
+            out.m[i] = (uint32_t)d;
+            borrow = (d >> 63) & 1u;
+        }
+    }
+
+    static void add(const BigFixed &a, const BigFixed &b, BigFixed &out, bool negateB = false)
+    {
+        bool na = a.neg, nb = b.neg != negateB;
+        if (na == nb)
+        {
+            add_mag(a, b, out);
+            out.neg = na;
+        }
+        else if (cmp_mag(a, b) >= 0)
+        {
+            sub_mag(a, b, out);
+            out.neg = na;
+        }
+        else
+        {
+            sub_mag(b, a, out);
+            out.neg = nb;
+        }
+        if (out.is_zero())
+            out.neg = false;
+    }
+
+    static void sub(const BigFixed &a, const BigFixed &b, BigFixed &out) { add(a, b, out, true); }
+
+    // Truncating product; `scratch` is reused across calls to avoid allocations.
+    static void mul(const BigFixed &a, const BigFixed &b, BigFixed &out, std::vector<uint32_t> &scratch)
+    {
+        const int n = a.limbs();
+        scratch.assign(size_t(2 * n), 0u);
+        for (int i = 0; i < n; ++i)
+        {
+            if (!a.m[i])
+                continue;
+            uint64_t carry = 0;
+            for (int j = 0; j < n; ++j)
+            {
+                uint64_t cur = (uint64_t)a.m[i] * b.m[j] + scratch[i + j] + carry;
+                scratch[i + j] = (uint32_t)cur;
+                carry = cur >> 32;
+            }
+            scratch[i + n] = (uint32_t)carry;
+        }
+        bool sign = a.neg != b.neg;
+        for (int k = 0; k < n; ++k)
+            out.m[k] = scratch[k + n - 1];
+        out.neg = sign && !out.is_zero();
+    }
+
+    void mul_small(uint32_t k)
+    {
+        uint64_t carry = 0;
+        for (auto &v : m)
+        {
+            uint64_t cur = (uint64_t)v * k + carry;
+            v = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+    }
+
+    void div_small(uint32_t k)
+    {
+        uint64_t rem = 0;
+        for (int i = limbs() - 1; i >= 0; --i)
+        {
+            uint64_t cur = (rem << 32) | m[i];
+            m[i] = (uint32_t)(cur / k);
+            rem = cur % k;
+        }
+    }
+
+    static BigFixed from_double(double v, int limbs)
+    {
+        BigFixed r(limbs);
+        r.neg = v < 0;
+        v = std::fabs(v);
+        double ip = std::floor(v);
+        r.m.back() = (uint32_t)ip;
+        double f = v - ip;
+        for (int i = r.limbs() - 2; i >= 0 && f > 0; --i)
+        {
+            f *= 4294967296.0;
+            double d = std::floor(f);
+            r.m[i] = (uint32_t)d;
+            f -= d;
+        }
+        if (r.is_zero())
+            r.neg = false;
+        return r;
+    }
+
+    // Decimal "[-]123.456[e-78]" at full precision (no round trip through double).
+    static bool from_string(const std::string &s, int limbs, BigFixed &out)
+    {
+        BigFixed r(limbs);
+        size_t i = 0;
+        bool negative = false;
+        if (i < s.size() && (s[i] == '-' || s[i] == '+'))
+            negative = s[i++] == '-';
+        std::string intDigits, fracDigits;
+        while (i < s.size() && std::isdigit((unsigned char)s[i]))
+            intDigits += s[i++];
+        if (i < s.size() && s[i] == '.')
+            for (++i; i < s.size() && std::isdigit((unsigned char)s[i]); ++i)
+                fracDigits += s[i];
+        if (intDigits.empty() && fracDigits.empty())
+            return false;
+        long exp10 = 0;
+        if (i < s.size() && (s[i] == 'e' || s[i] == 'E'))
+        {
+            char *e = nullptr;
+            exp10 = std::strtol(s.c_str() + i + 1, &e, 10);
+            if (e == s.c_str() + i + 1)
+                return false;
+            i = size_t(e - s.c_str());
+        }
+        if (i != s.size())
+            return false;
+
+        // apply the exponent by moving the decimal point over the digits, so
+        // nothing is truncated before scaling; `point` = digits before it
+        std::string digits = intDigits + fracDigits;
+        const size_t lead = std::min(digits.find_first_not_of('0'), digits.size());
+        digits.erase(0, lead);
+        long point = long(intDigits.size()) - long(lead);
+        const long maxPoint = 9;                 // 9 integer digits fit the top limb
+        const long minPoint = -10L * limbs - 1;  // below the last fraction bit
+        exp10 = std::clamp(exp10, minPoint - 1 - point, maxPoint + 1 - point);
+        point += exp10;
+        if (!digits.empty() && point > maxPoint)
+            return false;
+        if (digits.empty() || point < minPoint)
+            digits.clear(), point = 0;
+        if (point > long(digits.size()))
+            digits.append(size_t(point) - digits.size(), '0');
+        if (point < 0)
+            digits.insert(0, size_t(-point), '0'), point = 0;
+
+        // fraction by Horner from the last digit: f = (d + f) / 10
+        for (size_t k = digits.size(); k-- > size_t(point);)
+        {
+            r.m.back() += uint32_t(digits[k] - '0');
+            r.div_small(10);
+        }
+        BigFixed ip(limbs);
+        for (long k = 0; k < point; ++k)
+        {
+            ip.mul_small(10);
+            ip.m.back() += uint32_t(digits[size_t(k)] - '0');
+        }
+        add_mag(r, ip, r);
+        r.neg = negative && !r.is_zero();
+        out = std::move(r);
+        return true;
+    }
+
+    // Decimal text with `digits` fraction digits (truncated), as from_string reads it.
+    std::string to_string(int digits) const
+    {
+        BigFixed f = *this;
+        std::string s = (neg ? "-" : "") + std::to_string(f.m.back()) + ".";
+        for (int k = 0; k < digits; ++k)
+        {
+            f.m.back() = 0;
+            f.mul_small(10);
+            s += char('0' + f.m.back());
+        }
+        return s;
+    }
+
+    double to_double() const
+    {
+        double v = 0.0;
+        for (int i = 0; i < limbs(); ++i)
+            v += std::ldexp((double)m[i], 32 * (i - (limbs() - 1)));
+        return neg ? -v : v;
+    }
+};
+
+// Nearest double-double to a decimal string; `fallback` if it does not parse.
+static DoubleDouble dd_from_decimal(const std::string &s, double fallback)
+{
+    const int limbs = 5; // 128 fraction bits
+    BigFixed v, rest(limbs);
+    if (s.empty() || !BigFixed::from_string(s, limbs, v))
+        return DoubleDouble(fallback);
+    double h = v.to_double();
+    BigFixed::sub(v, BigFixed::from_double(h, limbs), rest);
+    return DoubleDouble::quick_two_sum(h, rest.to_double());
+}
+
+// --------------------------- Deep Zoom: Perturbation ---------------------------
+// One reference orbit Z_n is iterated in BigFixed and stored as doubles; every
+// pixel then iterates only its double-precision offset dz_n from it:
+//   dz_{n+1} = (2 Z_n + dz_n) dz_n + dc
+// A pixel whose |Z_n + dz_n| collapses far below |Z_n| (Pauldelbrot's
+// criterion) or outlives the reference is flagged as glitched and re-rendered
+// against a new reference placed inside the glitched area.
+//
+// In front of the per-pixel loop a cubic series approximation
+//   dz_n ~= A_n d + B_n d^2 + C_n d^3   (d = dc, or dz_0 for Julia)
+// jumps every pixel straight to iteration `skip`. The coefficients follow the
+// reference orbit; `skip` is the last n at which the dropped quartic term is
+// still negligible and the series matches exact perturbation at the frame's
+// corner and edge probes.
+
+// Whether double-precision pixel coordinates are too coarse for this view.
+static bool needs_deep_zoom(const FractalParams &p)
+{
+    if (p.type != FractalType::Mandelbrot && p.type != FractalType::Julia)
+        return false; // the perturbation engine only iterates z^2 + c
+    if (p.deep != DeepMode::Auto)
+        return p.deep == DeepMode::On;
+    double spacing = 2.0 * p.scale / std::max(1, p.full_width() - 1);
+    double mag = std::max({std::fabs(p.centerX), std::fabs(p.centerY), 1.0});
+    return spacing < mag * std::ldexp(1.0, -42); // < ~1000 ulps per pixel
+}
+
+// Whether a type with `bits` significand bits keeps the same ~1000-ulp
+// margin per pixel that needs_deep_zoom asks of double.
+static bool resolves_pixels(const FractalParams &p, int bits)
+{
+    double spacing = 2.0 * p.scale / std::max(1, p.full_width() - 1);
+    double mag = std::max({std::fabs(p.centerX), std::fabs(p.centerY), 1.0});
+    return spacing >= mag * std::ldexp(1.0, 11 - bits);
+}
+
+// Cheapest tier for the view. --deep on always means perturbation, which
+// runs on the double tier. Otherwise float (24 bits, twice the SIMD lanes)
+// for frames it resolves with the same margin as double, then double. Past
+// double, perturbation (deep zoom) is far cheaper than iterating every pixel
+// in double-double, so double-double is only picked when deep zoom is
+// switched off; it resolves down to a scale of about 1e-28.
+static Precision choose_precision(const FractalParams &p)
+{
+    if (p.deep == DeepMode::On && needs_deep_zoom(p))
+        return Precision::Double;
+    if (p.precision != Precision::Auto)
+        return p.precision;
+    if (resolves_pixels(p, 24))
+        return Precision::Float;
+    if (resolves_pixels(p, 53) || needs_deep_zoom(p))
+        return Precision::Double;
+    return Precision::DoubleDouble;
+}
+
+static const char *precision_name(Precision t)
+{
+    switch (t)
+    {
+    case Precision::Float:
+        return "float";
+    case Precision::Double:
+        return "double";
+    case Precision::DoubleDouble:
+        return "double-double";
+    default:
+        return "auto";
+    }
+}
+
+struct PerturbationEngine
+{
+    static constexpr double GlitchTolerance = 1e-6; // on |z|^2 / |Z|^2
+    static constexpr int MaxReferences = 64;
+    static constexpr double SeriesTolerance = 1e-7; // relative, on probes and truncation
+
+    const FractalParams &params;
+    bool julia;
+    int limbs;
+    BigFixed centerRe, centerIm;
+    double halfX, halfY; // complex-plane half extents of the view
+
+    // current reference: offset from the view centre and its orbit Z_0..Z_len-1
+    double refDr = 0.0, refDi = 0.0;
+    std::vector<double> Zr, Zi, Zmag2;
+    std::vector<double> primaryZr, primaryZi, primaryZmag2; // the centre reference's orbit
+    int references = 0;
+
+    // series approximation for the current reference
+    int skip = 0;
+    int primarySkip = 0; // skip of the centre reference, for reporting
+    std::complex<double> saA, saB, saC;
+
+    std::vector<uint8_t> glitched; // per pixel, written by the pixel's own thread
+    std::vector<float> glitchDepth; // |z|^2 / |Z|^2 at detection, smaller = deeper
+    size_t glitchesLeft = 0;
+
+    explicit PerturbationEngine(const FractalParams &p)
+        : params(p), julia(p.type == FractalType::Julia),
+          glitched(size_t(p.width) * p.height, 0), glitchDepth(size_t(p.width) * p.height, 0.0f)
+    {
+        double aspect = double(p.full_width()) / double(p.full_height());
+        halfX = p.scale;
+        halfY = p.scale / aspect;
+        // enough fraction bits for the pixel spacing plus a 64-bit guard
+        double spacing = 2.0 * p.scale / std::max(1, p.full_width() - 1);
+        int bits = std::max(64, (int)std::ceil(-std::log2(spacing)) + 64);
+        limbs = (bits + 31) / 32 + 1;
+        if (p.centerXStr.empty() || !BigFixed::from_string(p.centerXStr, limbs, centerRe))
+            centerRe = BigFixed::from_double(p.centerX, limbs);
+        if (p.centerYStr.empty() || !BigFixed::from_string(p.centerYStr, limbs, centerIm))
+            centerIm = BigFixed::from_double(p.centerY, limbs);
+        set_reference(0.0, 0.0);
+    }
+
+    int precision_bits() const { return 32 * (limbs - 1); }
+
+    // (x, y) are window pixels; the offset is relative to the frame centre.
+    inline void pixel_offset(double fx, double fy, double &dr, double &di) const
+    {
+        dr = halfX * (2.0 * (fx + params.originX) / double(params.full_width() - 1) - 1.0);
+        di = halfY * (1.0 - 2.0 * (fy + params.originY) / double(params.full_height() - 1)); // top->bottom
+    }
+
+    void set_reference(double dr, double di)
+    {
+        refDr = dr;
+        refDi = di;
+        ++references;
+        std::vector<uint32_t> scratch;
+        BigFixed pr(limbs), pi(limbs);
+        BigFixed::add(centerRe, BigFixed::from_double(dr, limbs), pr);
+        BigFixed::add(centerIm, BigFixed::from_double(di, limbs), pi);
+        BigFixed zr = julia ? pr : BigFixed(limbs), zi = julia ? pi : BigFixed(limbs);
+        BigFixed cr = julia ? BigFixed::from_double(params.juliaRe, limbs) : pr;
+        BigFixed ci = julia ? BigFixed::from_double(params.juliaIm, limbs) : pi;
+        BigFixed zr2(limbs), zi2(limbs), zri(limbs);
+
+        Zr.clear();
+        Zi.clear();
+        Zmag2.clear();
+        for (int n = 0; n <= params.maxIter; ++n)
+        {
+            double r = zr.to_double(), i = zi.to_double();
+            Zr.push_back(r);
+            Zi.push_back(i);
+            Zmag2.push_back(r * r + i * i);
+            if (r * r + i * i > 4.0)
+                break;
+            BigFixed::mul(zr, zr, zr2, scratch);
+            BigFixed::mul(zi, zi, zi2, scratch);
+            BigFixed::mul(zr, zi, zri, scratch);
+            BigFixed::sub(zr2, zi2, zr);
+            BigFixed::add(zr, cr, zr);
+            BigFixed::add(zri, zri, zi);
+            BigFixed::add(zi, ci, zi);
+        }
+        if (references == 1)
+        {
+            primaryZr = Zr;
+            primaryZi = Zi;
+            primaryZmag2 = Zmag2;
+        }
+        compute_series();
+        if (references == 1)
+            primarySkip = skip;
+    }
+
+    // Back to the centre reference without iterating it again. The series is
+    // refit, as its probes are the current window's corners and edges.
+    void restore_primary()
+    {
+        refDr = refDi = 0.0;
+        references = 1;
+        Zr = primaryZr;
+        Zi = primaryZi;
+        Zmag2 = primaryZmag2;
+        compute_series();
+        primarySkip = skip;
+    }
+
+    void compute_series()
+    {
+        using cd = std::complex<double>;
+        skip = 0;
+        if (!params.series)
+            return;
+
+        // probes: frame corners and edge midpoints, relative to the reference
+        std::vector<cd> probe, dz;
+        double r = 0.0;
+        for (int py = 0; py < 3; ++py)
+            for (int px = 0; px < 3; ++px)
+            {
+                if (px == 1 && py == 1)
+                    continue;
+                double dr, di;
+                pixel_offset(px * (params.width - 1) / 2, py * (params.height - 1) / 2, dr, di);
+                cd d(dr - refDr, di - refDi);
+                probe.push_back(d);
+                dz.push_back(julia ? d : cd(0.0, 0.0));
+                r = std::max(r, std::abs(d));
+            }
+
+        cd A(julia ? 1.0 : 0.0, 0.0), B(0.0, 0.0), C(0.0, 0.0);
+        const cd one(julia ? 0.0 : 1.0, 0.0);
+        const int len = (int)Zr.size();
+        for (int n = 0; n + 1 < len && n < params.maxIter; ++n)
+        {
+            if (n > 0)
+            {
+                if (std::abs(C) * r * r > SeriesTolerance * std::abs(A))
+                    return;
+                for (size_t k = 0; k < probe.size(); ++k)
+                {
+                    const cd &d = probe[k];
+                    cd approx = ((C * d + B) * d + A) * d;
+                    if (std::abs(approx - dz[k]) > SeriesTolerance * std::abs(dz[k]))
+                        return;
+                }
+                skip = n;
+                saA = A;
+                saB = B;
+                saC = C;
+            }
+            const cd Z(Zr[n], Zi[n]), Z1(Zr[n + 1], Zi[n + 1]);
+            for (size_t k = 0; k < probe.size(); ++k)
+            {
+                dz[k] = (2.0 * Z + dz[k]) * dz[k] + (julia ? cd(0.0, 0.0) : probe[k]);
+                if (std::norm(Z1 + dz[k]) > 4.0)
+                    return; // never skip past a probe's escape
+            }
+            cd nA = 2.0 * Z * A + one;
+            cd nB = 2.0 * Z * B + A * A;
+            cd nC = 2.0 * Z * C + 2.0 * A * B;
+            A = nA;
+            B = nB;
+            C = nC;
+        }
+    }
+
+    // Smooth iteration value for pixel (x,y) against the current reference;
+    // iterations run (not those skipped by the series) are added to `iters`.
+    double eval(int x, int y, uint64_t &iters) { return eval_at(x, y, size_t(y) * params.width + x, iters); }
+
+    // Point (fx, fy) in pixel units; glitch state is recorded under pixel idx.
+    double eval_at(double fx, double fy, size_t idx, uint64_t &iters)
+    {
+        double pr, pi;
+        pixel_offset(fx, fy, pr, pi);
+        double dcr = pr - refDr, dci = pi - refDi;
+        double dzr = julia ? dcr : 0.0, dzi = julia ? dci : 0.0;
+        if (julia)
+            dcr = dci = 0.0;
+
+        if (skip > 0)
+        {
+            std::complex<double> d = julia ? std::complex<double>(dzr, dzi) : std::complex<double>(dcr, dci);
+            std::complex<double> s = ((saC * d + saB) * d + saA) * d;
+            double zr = Zr[skip] + s.real(), zi = Zi[skip] + s.imag();
+            // a pixel already outside at `skip` escaped inside the skipped range
+            if (zr * zr + zi * zi <= 4.0)
+                return iterate(idx, skip, s.real(), s.imag(), dcr, dci, iters);
+        }
+        return iterate(idx, 0, dzr, dzi, dcr, dci, iters);
+    }
+
+    double iterate(size_t idx, int n0, double dzr, double dzi, double dcr, double dci, uint64_t &iters)
+    {
+        const int maxIter = params.maxIter;
+        const int len = (int)Zr.size();
+        glitched[idx] = 0;
+        for (int n = n0;; ++n)
+        {
+            double zr = Zr[n] + dzr, zi = Zi[n] + dzi;
+            double mag2 = zr * zr + zi * zi;
+            if (n >= maxIter || mag2 > 4.0)
+                iters += uint64_t(n - n0);
+            if (n >= maxIter)
+                return (double)maxIter;
+            if (mag2 > 4.0)
+                return smooth_from_escape(n, mag2, maxIter);
+            if (mag2 < GlitchTolerance * Zmag2[n] || n + 1 >= len)
+            {
+                iters += uint64_t(n - n0);
+                glitched[idx] = 1;
+                glitchDepth[idx] = Zmag2[n] > 0 ? float(mag2 / Zmag2[n]) : 0.0f;
+                return (double)maxIter;
+            }
+            double tr = 2.0 * Zr[n] + dzr, ti = 2.0 * Zi[n] + dzi;
+            double nr = tr * dzr - ti * dzi + dcr;
+            double ni = tr * dzi + ti * dzr + dci;
+            dzr = nr;
+            dzi = ni;
+        }
+    }
+
+    // Back to the primary reference at the view centre for a new frame.
+    void restart()
+    {
+        if (references != 1 || refDr != 0.0 || refDi != 0.0)
+            restore_primary();
+        glitchesLeft = 0;
+    }
+
+    // Picks the deepest glitched pixel as the next reference; false when clean.
+    bool next_reference(std::vector<int> &pending)
+    {
+        pending.clear();
+        int best = -1;
+        for (size_t i = 0; i < glitched.size(); ++i)
+        {
+            if (!glitched[i])
+                continue;
+            pending.push_back((int)i);
+            if (best < 0 || glitchDepth[i] < glitchDepth[best])
+                best = (int)i;
+        }
+        glitchesLeft = pending.size();
+        if (pending.empty() || references >= MaxReferences)
+            return false;
+        double dr, di;
+        pixel_offset(best % params.width, best / params.width, dr, di);
+        set_reference(dr, di);
+        return true;
+    }
+};
+
+// --------------------------- NUMA Placement ---------------------------
+// Workers are split into contiguous blocks per NUMA node, in proportion to
+// the node's CPUs, and each is pinned to one CPU of its node. A job of n items
+// is split evenly over the workers, so node k owns the items of its block of
+// workers: they first-touch those rows and render them before helping other
+// nodes. Without sysfs (or off Linux) there is one node and nothing is pinned.
+
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+static std::vector<int> parse_cpulist(const std::string &s)
+{
+    std::vector<int> ids;
+    std::stringstream ss(s);
+    std::string part;
+    while (std::getline(ss, part, ','))
+    {
+        int a, b;
+        int n = std::sscanf(part.c_str(), "%d-%d", &a, &b);
+        if (n == 1)
+            b = a;
+        if (n >= 1)
+            for (int c = a; c <= b; ++c)
+                ids.push_back(c);
+    }
+    return ids;
+}
+
+struct NumaTopology
+{
+    std::vector<std::vector<int>> nodeCpus; // usable CPUs of each node that has any
+
+    static NumaTopology detect()
+    {
+        NumaTopology t;
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        auto usable = [&](int c)
+        { return !masked || (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)); };
+        std::string line;
+        std::ifstream online("/sys/devices/system/node/online");
+        if (std::getline(online, line))
+            for (int n : parse_cpulist(line))
+            {
+                std::ifstream in("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+                std::vector<int> cpus;
+                if (std::getline(in, line))
+                    for (int c : parse_cpulist(line))
+                        if (usable(c))
+                            cpus.push_back(c);
+                if (!cpus.empty())
+                    t.nodeCpus.push_back(std::move(cpus));
+            }
+        if (t.nodeCpus.empty() && masked)
+        {
+            t.nodeCpus.emplace_back();
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &allowed))
+                    t.nodeCpus.back().push_back(c);
+        }
+#endif
+        if (t.nodeCpus.empty())
+            t.nodeCpus.emplace_back(); // one node, CPUs unknown
+        return t;
+    }
+};
+
+// Where each of `threads` workers runs.
+struct NumaPlan
+{
+    std::vector<int> cpu;         // per worker; -1 = not pinned
+    std::vector<int> node;        // per worker
+    std::vector<int> firstWorker; // node k has workers [firstWorker[k], firstWorker[k + 1])
+
+    NumaPlan(const NumaTopology &topo, int threads)
+    {
+        const int nodes = (int)topo.nodeCpus.size();
+        size_t total = 0;
+        for (const auto &c : topo.nodeCpus)
+            total += c.size();
+        size_t acc = 0;
+        firstWorker.push_back(0);
+        for (int k = 0; k < nodes; ++k)
+        {
+            acc += total ? topo.nodeCpus[k].size() : 1;
+            firstWorker.push_back(int(int64_t(threads) * acc / (total ? total : nodes)));
+        }
+        for (int k = 0; k < nodes; ++k)
+        {
+            const auto &cpus = topo.nodeCpus[k];
+            for (int w = firstWorker[k]; w < firstWorker[k + 1]; ++w)
+            {
+                cpu.push_back(cpus.empty() ? -1 : cpus[(w - firstWorker[k]) % cpus.size()]);
+                node.push_back(k);
+            }
+        }
+    }
+
+    int workers() const { return (int)cpu.size(); }
+    int nodes() const { return (int)firstWorker.size() - 1; }
+    // First of worker w's items out of n (w = workers() gives n).
+    int worker_begin(int w, int n) const { return int(int64_t(n) * w / std::max(1, workers())); }
+    int node_begin(int k, int n) const { return worker_begin(firstWorker[k], n); }
+};
+
+static void pin_current_thread(int cpu)
+{
+#ifdef __linux__
+    if (cpu < 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// Pins the calling thread to `cpu` while in scope, then gives it back its
+// previous affinity. OpenMP keeps its threads (the caller is thread 0), so
+// without this they would stay on one CPU for everything that runs later.
+class ScopedPin
+{
+public:
+    explicit ScopedPin(int cpu)
+    {
+#ifdef __linux__
+        saved = cpu >= 0 && pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous) == 0;
+        if (saved)
+            pin_current_thread(cpu);
+#else
+        (void)cpu;
+#endif
+    }
+
+    ~ScopedPin()
+    {
+#ifdef __linux__
+        if (saved)
+            pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+#endif
+    }
+
+    ScopedPin(const ScopedPin &) = delete;
+    ScopedPin &operator=(const ScopedPin &) = delete;
+
+private:
+#ifdef __linux__
+    cpu_set_t previous;
+    bool saved = false;
+#endif
+};
+
+// Runs body(worker) on every worker of the plan, each pinned to its CPU;
+// OpenMP threads when `omp` (unpinned again afterwards), std::thread otherwise.
+template <class F>
+static void run_pinned(const NumaPlan &plan, bool omp, F &&body)
+{
+#ifdef _OPENMP
+    if (omp)
+    {
+#pragma omp parallel num_threads(plan.workers())
+        {
+            const int w = omp_get_thread_num();
+            ScopedPin pin(plan.cpu[w]);
+            body(w);
+        }
+        return;
+    }
+#else
+    (void)omp;
+#endif
+    std::vector<std::thread> pool;
+    for (int w = 0; w < plan.workers(); ++w)
+        pool.emplace_back([&, w]()
+                          {
+            pin_current_thread(plan.cpu[w]);
+            body(w); });
+    for (auto &t : pool)
+        t.join();
+}
+
+// Hands out items [0, n) one at a time: a worker takes its own node's items
+// first, then the other nodes' in turn.
+class NumaScheduler
+{
+public:
+    NumaScheduler(const NumaPlan &p, int count) : plan(p), n(count), next(size_t(p.nodes()))
+    {
+        for (int k = 0; k < plan.nodes(); ++k)
+            next[k].v = plan.node_begin(k, n);
+    }
+
+    bool pop(int worker, int &item)
+    {
+        const int home = plan.node[worker], N = plan.nodes();
+        for (int j = 0; j < N; ++j)
+        {
+            const int k = (home + j) % N, end = plan.node_begin(k + 1, n);
+            if (next[k].v.load(std::memory_order_relaxed) >= end)
+                continue;
+            item = next[k].v.fetch_add(1);
+            if (item < end)
+            {
+                if (j > 0)
+                    ++remote;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int remote_items() const { return remote.load(); }
+
+private:
+    struct alignas(64) Cursor
+    {
+        std::atomic<int> v{0};
+    };
+    const NumaPlan &plan;
+    int n;
+    std::vector<Cursor> next;
+    std::atomic<int> remote{0};
+};
+
+// --------------------------- Work-Stealing Thread Pool ---------------------------
+// Persistent workers, each with its own task deque. A job of n tasks is dealt
+// out in contiguous blocks (so neighbouring tiles stay on one core); a worker
+// pops its own deque from the front and, once empty, steals from the back of
+// another worker's deque. The calling thread blocks until the job is done.
+// With a NumaPlan the workers are pinned and steal from their own node first.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int threads, const NumaPlan *plan = nullptr)
+        : queues(size_t(std::max(1, threads))), node(queues.size(), 0), cpu(queues.size(), -1), pinned(plan != nullptr)
+    {
+        if (plan)
+            for (int i = 0; i < std::min(size(), plan->workers()); ++i)
+            {
+                node[i] = plan->node[i];
+                cpu[i] = plan->cpu[i];
+            }
+        for (int i = 0; i < (int)queues.size(); ++i)
+            workers.emplace_back([this, i]()
+                                 { worker_main(i); });
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int size() const { return (int)queues.size(); }
+    bool numa() const { return pinned; }
+    uint64_t steals() const { return stealCount.load(); }
+
+    void run(int n, const std::function<void(int)> &fn)
+    {
+        const int T = size();
+        for (int w = 0; w < T; ++w)
+        {
+            std::lock_guard<std::mutex> lk(queues[w].m);
+            for (int t = int(int64_t(n) * w / T); t < int(int64_t(n) * (w + 1) / T); ++t)
+                queues[w].q.push_back(t);
+        }
+        std::unique_lock<std::mutex> lk(m);
+        job = &fn;
+        busy = T;
+        ++generation;
+        wake.notify_all();
+        done.wait(lk, [&]
+                  { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex m;
+        std::deque<int> q;
+    };
+
+    std::vector<Queue> queues;
+    std::vector<int> node, cpu; // per worker
+    bool pinned;
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable wake, done;
+    const std::function<void(int)> *job = nullptr;
+    uint64_t generation = 0;
+    int busy = 0;
+    bool stopping = false;
+    std::atomic<uint64_t> stealCount{0};
+
+    bool pop_local(int id, int &task)
+    {
+        std::lock_guard<std::mutex> lk(queues[id].m);
+        if (queues[id].q.empty())
+            return false;
+        task = queues[id].q.front();
+        queues[id].q.pop_front();
+        return true;
+    }
+
+    bool steal(int id, int &task)
+    {
+        const int T = size();
+        for (int pass = 0; pass < 2; ++pass) // same node first, then the rest
+            for (int k = 1; k < T; ++k)
+            {
+                const int victim = (id + k) % T;
+                if ((node[victim] == node[id]) != (pass == 0))
+                    continue;
+                Queue &v = queues[victim];
+                std::lock_guard<std::mutex> lk(v.m);
+                if (v.q.empty())
+                    continue;
+                task = v.q.back();
+                v.q.pop_back();
+                ++stealCount;
+                return true;
+            }
+        return false;
+    }
+
+    void worker_main(int id)
+    {
+        pin_current_thread(cpu[id]);
+        uint64_t seen = 0;
+        for (;;)
+        {
+            const std::function<void(int)> *fn;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                wake.wait(lk, [&]
+                          { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                fn = job;
+            }
+            int task;
+            while (pop_local(id, task) || steal(id, task))
+                (*fn)(task);
+            std::lock_guard<std::mutex> lk(m);
+            if (--busy == 0)
+                done.notify_all();
+        }
+    }
+};
+
+// --------------------------- Render Profiling ---------------------------
+// Opt-in instrumentation of one frame (--profile, --heatmap). Every work item
+// of the main pass (a row, a pool tile, a Mariani tile) is timed and counted
+// into the record of the thread that ran it, so threads never share a
+// counter. The other phases (glitch fixing, anti-aliasing, colouring) get
+// wall-clock times only. Without a profile the renderer pays one pointer
+// test per work item.
+struct ProfileItem
+{
+    int x0, y0, x1, y1; // pixel rectangle, half-open
+    int thread;
+    double ms;
+    uint64_t iterations;
+};
+
+struct alignas(64) ProfileThread
+{
+    int id = 0;
+    uint64_t iterations = 0, escaped = 0, interior = 0;
+    double busyMs = 0.0;
+    std::vector<ProfileItem> items;
+};
+
+class RenderProfile
+{
+public:
+    int workers = 1;                                     // threads the frame was given
+    std::vector<std::pair<const char *, double>> phases; // wall ms, in frame order
+    std::deque<ProfileThread> threads;                   // in order of first work item
+
+    void begin(int threadCount)
+    {
+        workers = threadCount;
+        phases.clear();
+        threads.clear();
+        epoch = nextEpoch++;
+        clock.start();
+    }
+
+    // Closes the phase running since begin() or the previous mark.
+    void mark(const char *phase)
+    {
+        phases.emplace_back(phase, clock.stop_ms());
+        clock.start();
+    }
+
+    double phase_ms(const char *phase) const
+    {
+        double ms = 0.0;
+        for (const auto &[name, t] : phases)
+            if (std::strcmp(name, phase) == 0)
+                ms += t;
+        return ms;
+    }
+
+    // The calling thread's record for this frame, created on first use.
+    ProfileThread &self()
+    {
+        thread_local uint64_t seen = 0;
+        thread_local ProfileThread *rec = nullptr;
+        if (seen != epoch)
+        {
+            std::lock_guard<std::mutex> lk(m);
+            rec = &threads.emplace_back();
+            rec->id = int(threads.size()) - 1;
+            seen = epoch;
+        }
+        return *rec;
+    }
+
+    std::vector<double> item_ms() const
+    {
+        std::vector<double> ms;
+        for (const ProfileThread &t : threads)
+            for (const ProfileItem &it : t.items)
+                ms.push_back(it.ms);
+        return ms;
+    }
+
+    // Render cost per pixel: each item's time spread over its rectangle,
+    // shown with the fire palette on a square-root scale of the most
+    // expensive pixel, so cheap regions stay distinguishable.
+    void heatmap(ImageRGB &img) const
+    {
+        std::vector<float> cost(size_t(img.w) * img.h, 0.0f);
+        for (const ProfileThread &t : threads)
+            for (const ProfileItem &it : t.items)
+            {
+                const float perPixel = float(it.ms / std::max(1.0, double(it.x1 - it.x0) * (it.y1 - it.y0)));
+                for (int y = it.y0; y < it.y1; ++y)
+                    for (int x = it.x0; x < it.x1; ++x)
+                        cost[size_t(y) * img.w + x] += perPixel;
+            }
+        const float peak = std::max(1e-12f, *std::max_element(cost.begin(), cost.end()));
+        ColorMap fire;
+        fire.type = PaletteType::Fire;
+        const int ri = img.red_offset(), bi = 2 - ri;
+        for (int y = 0; y < img.h; ++y)
+        {
+            uint8_t *px = img.row_ptr(y);
+            for (int x = 0; x < img.w; ++x, px += 3)
+                fire.color_at(std::sqrt(cost[size_t(y) * img.w + x] / peak), px[ri], px[1], px[bi]);
+        }
+    }
+
+private:
+    static inline std::atomic<uint64_t> nextEpoch{1}; // tells frames apart in thread-local caches
+    uint64_t epoch = 0;
+    Timer clock;
+    std::mutex m;
+};
+
+// --------------------------- CPU Renderer ---------------------------
+enum class RenderMode
+{
+    Full,
+    Mariani,    // Mariani-Silver rectangle subdivision
+    Progressive, // coarse-to-fine passes, optionally cut off at a deadline
+    Distance     // distance-estimator block fill
+};
+
+enum class Backend
+{
+    Auto,
+    Omp,
+    Threads,
+    Serial,
+    Pool // persistent work-stealing pool over 2D tiles
+};
+
+struct CPURenderer
+{
+    // Kernels instantiated for the frame's formula and tier, bound once per
+    // frame (bind_kernels): a span of a row, and a single point in pixel units.
+    using SpanKernel = void (CPURenderer::*)(int y, int xb, int xe, int step) const;
+    using PointKernel = double (CPURenderer::*)(double fx, double fy, uint64_t &iters) const;
+    using DistanceKernel = DistanceSample (CPURenderer::*)(int x, int y, uint64_t &iters) const;
+
+    const FractalParams &params;
+    const ColorMap &cmap;
+    PlaneMapper mapper;
+    SimdLevel simd = SimdLevel::Scalar; // Scalar = one pixel at a time
+    std::unique_ptr<PerturbationEngine> deep; // set when doubles cannot resolve the view
+    Precision tier = Precision::Double;       // scalar type of the direct kernels
+    DoubleDouble ddCenterRe, ddCenterIm;      // full-precision centre for the double-double tier
+    mutable std::atomic<uint64_t> iterations{0}; // iterations run in the last frame
+    int tileW = 64, tileH = 16;                  // 2D tile size for the pool backend
+    mutable std::unique_ptr<WorkStealingPool> pool; // created on first use, kept across frames
+    mutable IterField field;                        // smooth iteration values of the last frame
+    double deadlineMs = 0.0;                        // progressive mode budget, 0 = none
+    int aaSamples = 0;                              // samples per edge pixel, 0 = no anti-aliasing
+    float aaThreshold = 1.0f;                       // neighbourhood std-dev (iterations) marking an edge
+    mutable int progressiveStep = 0;                // finest grid step completed in the last frame
+    mutable SpanKernel spanKernel = nullptr;
+    mutable PointKernel pointKernel = nullptr;
+    mutable DistanceKernel distanceKernel = nullptr; // null: no estimator for this formula/tier
+    bool distanceChannel = false;                    // keep per-pixel estimates in `distance`
+    mutable std::vector<float> distance;             // in pixels, 0 inside, after a distance render
+    mutable std::atomic<size_t> distanceBlocks{0};   // blocks filled from one evaluation
+    bool numa = false;                              // pinned, node-local full renders
+    mutable std::unique_ptr<NumaPlan> numaPlan;     // for the last thread count
+    mutable bool fieldPlaced = false;               // field pages first-touched by their nodes
+    mutable int numaRemoteRows = -1;                // rows rendered off their node, -1 = n/a
+    std::unique_ptr<RenderProfile> profile;         // per-frame instrumentation, null = off
+    bool incremental = false;                       // full renders reuse the last frame's field
+    mutable decltype(IterField::s) previous;        // the last frame's field during such a reuse
+    mutable size_t reusedPixels = 0;                // pixels of the last frame taken from the one before
+    mutable const char *reuseKind = nullptr;        // "pan", "zoom in", "zoom out"; null = none
+
+    static inline thread_local uint64_t threadIterations = 0; // this thread's running total
+
+    CPURenderer(const FractalParams &p, const ColorMap &c)
+        : params(p), cmap(c), mapper(p), field(p.width, p.height, p.maxIter)
+    {
+        select_kernels();
+    }
+
+    // Picks up a new view written into `params` (same size) for the next
+    // frame, keeping the thread pool and the field allocation.
+    void retarget()
+    {
+        mapper = PlaneMapper(params);
+        field.maxIter = params.maxIter;
+        select_kernels();
+    }
+
+    // Picks up a window of the same size moved within the same frame (only
+    // originX/originY changed). The tier and any reference orbit depend on
+    // the frame alone, so they are kept; the series is refit to the window.
+    void move_window()
+    {
+        mapper = PlaneMapper(params);
+        if (deep)
+            deep->restore_primary();
+    }
+
+    // Precision tier for the current view; perturbation takes over from the
+    // double tier once doubles cannot resolve the pixels.
+    void select_kernels()
+    {
+        tier = choose_precision(params);
+        deep.reset();
+        if (tier == Precision::Double && needs_deep_zoom(params))
+            deep = std::make_unique<PerturbationEngine>(params);
+        if (tier == Precision::DoubleDouble)
+        {
+            ddCenterRe = dd_from_decimal(params.centerXStr, params.centerX);
+            ddCenterIm = dd_from_decimal(params.centerYStr, params.centerY);
+        }
+    }
+
+    // Point (fx, fy), in pixels of the window, in the tier's scalar type.
+    // Double-double offsets the exact centre, since xMin/xMax are only double.
+    template <typename T>
+    inline void subpixel_point(double fx, double fy, T &cr, T &ci) const
+    {
+        if constexpr (std::is_same_v<T, DoubleDouble>)
+        {
+            const double halfY = params.scale * double(mapper.height) / double(mapper.width);
+            cr = ddCenterRe + params.scale * (2.0 * (fx + mapper.originX) / double(mapper.width - 1) - 1.0);
+            ci = ddCenterIm + halfY * (1.0 - 2.0 * (fy + mapper.originY) / double(mapper.height - 1));
+        }
+        else
+        {
+            double r, i;
+            mapper.subpixel_to_complex(fx, fy, r, i);
+            cr = T(r);
+            ci = T(i);
+        }
+    }
+
+    template <typename T>
+    inline void pixel_point(int x, int y, T &cr, T &ci) const { subpixel_point(double(x), double(y), cr, ci); }
+
+    inline void store(int x, int y, double s) const { field.at(x, y) = (float)s; }
+
+    inline void count_iterations(uint64_t n) const
+    {
+        iterations += n;
+        threadIterations += n;
+    }
+
+    // Colorization pass over the kept field. It is independent of the fractal
+    // evaluation, so the same frame can be re-colored with any ColorMap.
+    void colorize(ImageRGB &img, const ColorMap &cm, int threads) const
+    {
+        // an image left for a NUMA first touch that did not run (another
+        // mode or backend): nothing else writes its row padding
+        const bool padding = img.untouched;
+        parallel_for(params.height, threads, 8, [&](int y)
+                     {
+            if (padding)
+                img.clear_padding(y);
+            colorize_row(img, cm, y); });
+        img.untouched = false;
+    }
+
+    void colorize_row(ImageRGB &img, const ColorMap &cm, int y) const
+    {
+        const float *src = &field.s[size_t(y) * field.w];
+        uint8_t *dst = img.row_ptr(y);
+        const int ri = img.red_offset(), bi = 2 - ri;
+        for (int x = 0; x < field.w; ++x, dst += 3)
+            cm.colorize(src[x], field.maxIter, dst[ri], dst[1], dst[bi]);
+        if (field.aaPixel.empty())
+            return;
+
+        // anti-aliased pixels of this row: mean colour of their samples
+        const size_t rowStart = size_t(y) * field.w, rowEnd = rowStart + field.w;
+        auto it = std::lower_bound(field.aaPixel.begin(), field.aaPixel.end(), rowStart);
+        for (; it != field.aaPixel.end() && *it < rowEnd; ++it)
+        {
+            const float *smp = &field.aaSamples[size_t(it - field.aaPixel.begin()) * field.aaCount];
+            int sr = 0, sg = 0, sb = 0;
+            for (int c = 0; c < field.aaCount; ++c)
+            {
+                uint8_t r, g, b;
+                cm.colorize(smp[c], field.maxIter, r, g, b);
+                sr += r;
+                sg += g;
+                sb += b;
+            }
+            uint8_t *px = img.row_ptr(y) + (*it - rowStart) * 3;
+            const int n = field.aaCount, half = n / 2;
+            px[ri] = uint8_t((sr + half) / n);
+            px[1] = uint8_t((sg + half) / n);
+            px[bi] = uint8_t((sb + half) / n);
+        }
+    }
+
+    template <class F, typename T>
+    DistanceSample eval_distance(int x, int y, uint64_t &iters) const
+    {
+        T pr, pi;
+        pixel_point(x, y, pr, pi);
+        if constexpr (F::Julia)
+            return escape_distance<F>(pr, pi, T(params.juliaRe), T(params.juliaIm), params.maxIter, params.interiorChecks, iters);
+        else
+            return escape_distance<F>(T(0.0), T(0.0), pr, pi, params.maxIter, params.interiorChecks, iters);
+    }
+
+    template <class F, typename T>
+    double eval_point(double fx, double fy, uint64_t &iters) const
+    {
+        T pr, pi;
+        subpixel_point(fx, fy, pr, pi);
+        if constexpr (F::Julia)
+            return escape_smooth<F>(pr, pi, T(params.juliaRe), T(params.juliaIm), params.maxIter, params.interiorChecks, iters);
+        else
+            return escape_smooth<F>(T(0.0), T(0.0), pr, pi, params.maxIter, params.interiorChecks, iters);
+    }
+
+    // Pixels xb, xb + step, ... < xe of row y.
+    template <class F, typename T>
+    void render_span_scalar(int y, int xb, int xe, int step) const
+    {
+        uint64_t iters = 0;
+        for (int x = xb; x < xe; x += step)
+            store(x, y, eval_point<F, T>(x, y, iters));
+        count_iterations(iters);
+    }
+
+    // Packs `lanes` neighbouring pixels of the span per batch; the ragged tail
+    // repeats the last pixel so every batch is full width and the extra lanes
+    // are dropped.
+    template <class F, typename T>
+    void render_span_simd(int y, int xb, int xe, int step) const
+    {
+        const int lanes = simd_lanes(simd, sizeof(T));
+        constexpr bool julia = F::Julia;
+        const int last = xb + (xe - 1 - xb) / step * step;
+        EscapeBatch<T> b;
+        uint64_t iters = 0;
+        for (int x0 = xb; x0 < xe; x0 += lanes * step)
+        {
+            for (int l = 0; l < lanes; ++l)
+            {
+                T pr, pi;
+                pixel_point(std::min(x0 + l * step, last), y, pr, pi);
+                b.zr[l] = julia ? pr : T(0.0);
+                b.zi[l] = julia ? pi : T(0.0);
+                b.cr[l] = julia ? T(params.juliaRe) : pr;
+                b.ci[l] = julia ? T(params.juliaIm) : pi;
+            }
+            escape_batch<F>(b, simd, params.maxIter, params.interiorChecks);
+            int n = std::min(lanes, (xe - x0 + step - 1) / step);
+            for (int l = 0; l < n; ++l)
+            {
+                iters += uint64_t(b.steps[l]);
+                store(x0 + l * step, y, smooth_from_escape<F::Degree>(b.iters[l], b.mag2[l], params.maxIter));
+            }
+        }
+        count_iterations(iters);
+    }
+
+    void render_span_deep(int y, int xb, int xe, int step) const
+    {
+        uint64_t iters = 0;
+        for (int x = xb; x < xe; x += step)
+            store(x, y, deep->eval(x, y, iters));
+        count_iterations(iters);
+    }
+
+    inline void render_span(int y, int xb, int xe, int step = 1) const { (this->*spanKernel)(y, xb, xe, step); }
+
+    // Binds the kernels for the frame's formula; Multibrot degrees are
+    // instantiated from MultibrotMinPower to MultibrotMaxPower.
+    void bind_kernels() const
+    {
+        switch (params.type)
+        {
+        case FractalType::Julia:
+            return bind_formula<JuliaFormula>();
+        case FractalType::BurningShip:
+            return bind_formula<BurningShipFormula>();
+        case FractalType::Tricorn:
+            return bind_formula<TricornFormula>();
+        case FractalType::Multibrot:
+            return bind_multibrot<MultibrotMinPower>();
+        default:
+            return bind_formula<MandelbrotFormula>();
+        }
+    }
+
+    template <int D>
+    void bind_multibrot() const
+    {
+        if constexpr (D < MultibrotMaxPower)
+            if (params.power > D)
+                return bind_multibrot<D + 1>();
+        bind_formula<MultibrotFormula<D>>();
+    }
+
+    template <class F>
+    void bind_formula() const
+    {
+        const bool vec = simd != SimdLevel::Scalar;
+        if (tier == Precision::DoubleDouble)
+        {
+            spanKernel = &CPURenderer::render_span_scalar<F, DoubleDouble>;
+            pointKernel = &CPURenderer::eval_point<F, DoubleDouble>;
+        }
+        else if (tier == Precision::Float)
+        {
+            spanKernel = vec ? &CPURenderer::render_span_simd<F, float> : &CPURenderer::render_span_scalar<F, float>;
+            pointKernel = &CPURenderer::eval_point<F, float>;
+        }
+        else
+        {
+            spanKernel = vec ? &CPURenderer::render_span_simd<F, double> : &CPURenderer::render_span_scalar<F, double>;
+            pointKernel = &CPURenderer::eval_point<F, double>;
+        }
+        if (deep)
+            spanKernel = &CPURenderer::render_span_deep;
+
+        // the estimator runs in double for the float tier too: the derivative
+        // grows far past float range near the set
+        distanceKernel = nullptr;
+        if constexpr (has_distance_estimate<F>())
+            if (!deep)
+                distanceKernel = tier == Precision::DoubleDouble ? &CPURenderer::eval_distance<F, DoubleDouble>
+                                                                 : &CPURenderer::eval_distance<F, double>;
+    }
+
+    // One work item of the main pass, covering every xStep-th pixel of
+    // [x0, x1) x [y0, y1). With a profile it is timed, and its iterations
+    // and escaped/interior pixels are added to the calling thread's record.
+    template <class W>
+    inline void work_item(int x0, int y0, int x1, int y1, int xStep, W &&work) const
+    {
+        if (!profile)
+        {
+            work();
+            return;
+        }
+        ProfileThread &rec = profile->self();
+        const uint64_t before = threadIterations;
+        Timer t;
+        t.start();
+        work();
+        const double ms = t.stop_ms();
+        uint64_t pixels = 0, interior = 0;
+        for (int y = y0; y < y1; ++y)
+            for (int x = x0; x < x1; x += xStep, ++pixels)
+                interior += field.at(x, y) >= float(params.maxIter);
+        rec.items.push_back({x0, y0, x1, y1, rec.id, ms, threadIterations - before});
+        rec.iterations += threadIterations - before;
+        rec.escaped += pixels - interior;
+        rec.interior += interior;
+        rec.busyMs += ms;
+    }
+
+    inline void mark(const char *phase) const
+    {
+        if (profile)
+            profile->mark(phase);
+    }
+
+    inline void render_row(int y) const
+    {
+        work_item(0, y, params.width, y + 1, 1, [&]
+                  { render_span(y, 0, params.width); });
+    }
+
+    // Runs fn(0..n-1) in dynamic chunks: OpenMP when available, std::thread otherwise.
+    template <class F>
+    static void parallel_for(int n, int threads, int chunk, F &&fn)
+    {
+        threads = std::max(1, threads);
+        if (threads == 1)
+        {
+            for (int k = 0; k < n; ++k)
+                fn(k);
+            return;
+        }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, chunk) num_threads(threads)
+        for (int k = 0; k < n; ++k)
+            fn(k);
+#else
+        std::atomic<int> next{0};
+        std::vector<std::thread> pool;
+        for (int i = 0; i < threads; ++i)
+            pool.emplace_back([&]()
+                              {
+                for (int k; (k = next.fetch_add(chunk)) < n;)
+                    for (int e = std::min(n, k + chunk); k < e; ++k)
+                        fn(k); });
+        for (auto &t : pool)
+            t.join();
+#endif
+    }
+
+    // Runs fn(0..n-1) on a resolved backend: the work-stealing pool, plain
+    // std::threads, one thread for Serial, parallel_for otherwise.
+    template <class F>
+    void run_on(Backend backend, int n, int threads, F &&fn) const
+    {
+        threads = std::max(1, threads);
+        if (backend == Backend::Pool)
+            return worker_pool(threads).run(n, fn);
+        if (backend != Backend::Threads || threads == 1)
+            return parallel_for(n, backend == Backend::Serial ? 1 : threads, 1, fn);
+        std::atomic<int> next{0};
+        std::vector<std::thread> pool;
+        for (int i = 0; i < threads; ++i)
+            pool.emplace_back([&]()
+                              {
+                for (int k; (k = next.fetch_add(1)) < n;)
+                    fn(k); });
+        for (auto &t : pool)
+            t.join();
+    }
+
+    // Deep zoom: re-render glitched pixels against fresh references until
+    // none remain or the reference budget is spent.
+    void resolve_glitches(int threads) const
+    {
+        if (!deep)
+            return;
+        std::vector<int> pending;
+        while (deep->next_reference(pending))
+        {
+            parallel_for((int)pending.size(), threads, 64, [&](int k)
+                         {
+                int x = pending[k] % params.width, y = pending[k] / params.width;
+                uint64_t iters = 0;
+                store(x, y, deep->eval(x, y, iters));
+                count_iterations(iters); });
+        }
+    }
+
+    // ----- Adaptive anti-aliasing -----
+    // A pixel is an edge when the standard deviation of the smooth iteration
+    // counts in its 3x3 neighbourhood exceeds aaThreshold (the set boundary
+    // always qualifies). Only edge pixels are sampled again, on a k x k grid
+    // of cells with one jittered sample per cell; colorize averages the
+    // samples' colours, so the plain field stays one value per pixel.
+    void antialias(int threads) const
+    {
+        if (aaSamples <= 1)
+            return;
+        const int W = params.width, H = params.height;
+        const int k = std::max(2, (int)std::lround(std::sqrt((double)aaSamples)));
+
+        // A window of a larger frame (tile, band, worker) also evaluates the
+        // ring of frame pixels around it, so its edge test sees the same 3x3
+        // neighbourhoods as a full render. Deep zoom keeps the window's own.
+        const bool ring = !deep;
+        const int xlo = ring && params.originX > 0 ? -1 : 0, ylo = ring && params.originY > 0 ? -1 : 0;
+        const int xhi = ring && params.originX + W < params.full_width() ? W : W - 1;
+        const int yhi = ring && params.originY + H < params.full_height() ? H : H - 1;
+        std::vector<float> above(size_t(W) + 2), below(size_t(W) + 2), left(H), right(H);
+        uint64_t ringIters = 0;
+        auto ring_eval = [&](int x, int y)
+        { return (float)(this->*pointKernel)(double(x), double(y), ringIters); };
+        for (int x = xlo; x <= xhi; ++x)
+        {
+            if (ylo < 0)
+                above[size_t(x + 1)] = ring_eval(x, -1);
+            if (yhi == H)
+                below[size_t(x + 1)] = ring_eval(x, H);
+        }
+        for (int y = 0; y < H; ++y)
+        {
+            if (xlo < 0)
+                left[size_t(y)] = ring_eval(-1, y);
+            if (xhi == W)
+                right[size_t(y)] = ring_eval(W, y);
+        }
+        count_iterations(ringIters);
+        auto value = [&](int x, int y) -> float
+        {
+            if (y < 0 || y >= H)
+                return (y < 0 ? above : below)[size_t(x + 1)];
+            if (x < 0 || x >= W)
+                return (x < 0 ? left : right)[size_t(y)];
+            return field.at(x, y);
+        };
+
+        std::vector<std::vector<size_t>> rows(H);
+        parallel_for(H, threads, 8, [&](int y)
+                     {
+            for (int x = 0; x < W; ++x)
+            {
+                double sum = 0.0, sum2 = 0.0;
+                int n = 0;
+                for (int ny = std::max(ylo, y - 1); ny <= std::min(yhi, y + 1); ++ny)
+                    for (int nx = std::max(xlo, x - 1); nx <= std::min(xhi, x + 1); ++nx, ++n)
+                    {
+                        double v = value(nx, ny);
+                        sum += v;
+                        sum2 += v * v;
+                    }
+                double mean = sum / n;
+                if (sum2 / n - mean * mean > double(aaThreshold) * aaThreshold)
+                    rows[y].push_back(size_t(y) * W + x);
+            } });
+        field.aaPixel.clear(); // stays ascending even if a frame runs this twice
+        for (auto &r : rows)
+            field.aaPixel.insert(field.aaPixel.end(), r.begin(), r.end());
+        field.aaCount = k * k;
+        field.aaSamples.resize(field.aaPixel.size() * field.aaCount);
+
+        const int edges = (int)field.aaPixel.size();
+        parallel_for((edges + 63) / 64, threads, 1, [&](int chunk)
+                     {
+            uint64_t iters = 0;
+            for (int e = chunk * 64; e < std::min(edges, chunk * 64 + 64); ++e)
+            {
+                const size_t idx = field.aaPixel[e];
+                const int x = int(idx % W), y = int(idx / W);
+                float *out = &field.aaSamples[size_t(e) * field.aaCount];
+                // seeded by the pixel's place in the whole frame, so tiles,
+                // bands and workers jitter exactly like a full render
+                const uint32_t pixel = uint32_t(params.originY + y) * uint32_t(params.full_width()) + uint32_t(params.originX + x);
+                uint32_t h = pixel * 0x9E3779B9u + 0x7F4A7C15u;
+                for (int c = 0; c < field.aaCount; ++c)
+                {
+                    // cheap deterministic jitter (xorshift) so renders are repeatable
+                    h ^= h << 13;
+                    h ^= h >> 17;
+                    h ^= h << 5;
+                    double jx = (h & 0xFFFF) / 65536.0, jy = (h >> 16) / 65536.0;
+                    double fx = x - 0.5 + (c % k + jx) / k, fy = y - 0.5 + (c / k + jy) / k;
+                    out[c] = (float)eval_sample(fx, fy, idx, iters);
+                }
+            }
+            count_iterations(iters); });
+    }
+
+    double eval_sample(double fx, double fy, size_t idx, uint64_t &iters) const
+    {
+        if (deep)
+        {
+            // samples are taken against the last reference; a glitched one
+            // falls back to the pixel's own value
+            double v = deep->eval_at(fx, fy, idx, iters);
+            return deep->glitched[idx] ? (double)field.s[idx] : v;
+        }
+        return (this->*pointKernel)(fx, fy, iters);
+    }
+
+    void begin_frame(int threads) const
+    {
+        if (profile)
+            profile->begin(threads);
+        bind_kernels();
+        iterations = 0;
+        numaRemoteRows = -1;
+        distance.clear();
+        distanceBlocks = 0;
+        reusedPixels = 0;
+        reuseKind = nullptr;
+        field.family.clear();
+        field.clear_aa();
+        if (deep)
+            deep->restart();
+    }
+
+    // Shared end of a frame once the main pass has filled the field.
+    void finish_frame(ImageRGB &img, int threads) const
+    {
+        mark("iterate");
+        resolve_glitches(threads);
+        mark("glitches");
+        antialias(threads);
+        mark("antialias");
+        colorize(img, cmap, threads);
+        mark("colorize");
+    }
+
+    void render_serial(ImageRGB &img) const
+    {
+        begin_frame(1);
+        for (int y = 0; y < params.height; ++y)
+            render_row(y);
+        finish_frame(img, 1);
+    }
+
+#ifdef _OPENMP
+    void render_omp(ImageRGB &img, int threads) const
+    {
+        if (numa)
+            return render_numa(img, threads, true);
+        begin_frame(threads);
+#pragma omp parallel for schedule(dynamic, 4) num_threads(threads)
+        for (int y = 0; y < params.height; ++y)
+            render_row(y);
+        finish_frame(img, threads);
+    }
+#endif
+
+    void render_threads(ImageRGB &img, int threads) const
+    {
+        if (numa)
+            return render_numa(img, threads, false);
+        if (threads <= 1)
+        {
+            render_serial(img);
+            return;
+        }
+        threads = std::max(1, threads);
+        begin_frame(threads);
+        std::vector<std::thread> pool;
+        std::atomic<int> nextRow{0};
+        auto worker = [&]()
+        {
+            int y;
+            while ((y = nextRow.fetch_add(1)) < params.height)
+                render_row(y);
+        };
+        pool.reserve(threads);
+        for (int i = 0; i < threads; ++i)
+            pool.emplace_back(worker);
+        for (auto &t : pool)
+            t.join();
+        finish_frame(img, threads);
+    }
+
+    // ----- Incremental re-render -----
+    // A complete full frame leaves its view in the field (keep_view). When
+    // the next view shares the field's other inputs and its pixels lie on
+    // the last frame's grid, those pixels are copied and only the rest is
+    // evaluated: a pan by whole pixels computes the exposed strips, a 2x zoom
+    // in every pixel but every second one of every second row, and a 2x zoom
+    // out the border around the old frame shrunk to a quarter. Offsets must
+    // match to 1/1000 of a pixel. Double-double and perturbation views are
+    // not matched, as their offsets do not fit a double.
+
+    // Everything but the view that the field's values depend on.
+    std::string field_family() const
+    {
+        std::ostringstream k;
+        k << std::hexfloat << params.width << "x" << params.height << " type " << int(params.type) << " power "
+          << params.power << " julia " << params.juliaRe << " " << params.juliaIm << " maxiter " << params.maxIter
+          << " interior " << params.interiorChecks << " tier " << int(tier) << " simd " << int(simd) << " deep "
+          << (deep != nullptr);
+        return k.str();
+    }
+
+    IterField::View current_view() const
+    {
+        IterField::View v;
+        mapper.pixel_to_complex(0, 0, v.re0, v.im0);
+        v.stepRe = (mapper.xMax - mapper.xMin) / double(mapper.width - 1);
+        v.stepIm = -(mapper.yMax - mapper.yMin) / double(mapper.height - 1);
+        return v;
+    }
+
+    void keep_view() const
+    {
+        field.view = current_view();
+        field.family = field_family();
+    }
+
+    // New pixels lo, lo + stride, ... < hi of one axis lie on the old pixels
+    // (num + i * mul) / div.
+    struct AxisReuse
+    {
+        int lo = 0, hi = 0, stride = 1;
+        int64_t num = 0, mul = 1, div = 1;
+        int old(int i) const { return int((num + i * mul) / div); }
+        bool keeps(int i) const { return i >= lo && i < hi && (i - lo) % stride == 0; }
+    };
+
+    // Matches an axis of n pixels at o0 + i * os to the new one at n0 + i * ns.
+    // Offsets within 1/1000 of a pixel count as whole. PlaneMapper is not
+    // exact under such shifts, so a reused pixel can sit a few ulps off the
+    // point a fresh render of the new view would iterate.
+    static bool match_axis(double o0, double os, double n0, double ns, int n, AxisReuse &a)
+    {
+        const double ratio = ns / os, offset = (n0 - o0) / os; // in old pixels
+        if (!(std::abs(offset) < 4.0 * n))
+            return false;
+        auto whole = [](double v, int64_t &k)
+        {
+            k = std::llround(v);
+            return std::abs(v - double(k)) < 1e-3;
+        };
+        if (std::abs(ratio - 0.5) < 1e-9)
+        {
+            // zoom in: new pixel i is old (2 offset + i) / 2 when that is whole
+            if (!whole(2.0 * offset, a.num))
+                return false;
+            a.mul = 1;
+            a.div = a.stride = 2;
+            a.lo = int(std::max<int64_t>(0, -a.num));
+            a.lo += int((a.num + a.lo) & 1);
+            a.hi = int(std::min<int64_t>(n, 2 * int64_t(n) - 1 - a.num));
+        }
+        else if (std::abs(ratio - 1.0) < 1e-9 || std::abs(ratio - 2.0) < 1e-9)
+        {
+            // pan or zoom out: new pixel i is old offset + ratio i
+            if (!whole(offset, a.num))
+                return false;
+            a.mul = std::llround(ratio);
+            a.div = a.stride = 1;
+            a.lo = int(std::max(0.0, std::ceil(double(-a.num) / double(a.mul))));
+            a.hi = int(std::min(double(n), std::floor(double(n - 1 - a.num) / double(a.mul)) + 1.0));
+        }
+        else
+            return false;
+        return a.lo < a.hi;
+    }
+
+    // A full frame built on the last one; false, with nothing rendered, when
+    // the views do not allow it. `evaluated` gets the pixels computed.
+    bool render_incremental(ImageRGB &img, int threads, size_t &evaluated) const
+    {
+        const int W = params.width, H = params.height;
+        const IterField::View v = current_view();
+        AxisReuse ax, ay;
+        if (field.family.empty() || tier == Precision::DoubleDouble || deep || field.family != field_family() ||
+            !match_axis(field.view.re0, field.view.stepRe, v.re0, v.stepRe, W, ax) ||
+            !match_axis(field.view.im0, field.view.stepIm, v.im0, v.stepIm, H, ay) || ax.mul != ay.mul ||
+            ax.div != ay.div)
+            return false;
+        previous.swap(field.s);
+        field.s.resize(previous.size()); // every pixel is copied or rendered below
+        begin_frame(threads);
+        reuseKind = ax.div == 2 ? "zoom in" : ax.mul == 2 ? "zoom out" : "pan";
+        const size_t keptPerRow = size_t((ax.hi - ax.lo + ax.stride - 1) / ax.stride);
+        std::atomic<size_t> kept{0};
+        parallel_for(H, threads, 4, [&](int y)
+                     { work_item(0, y, W, y + 1, 1, [&]
+                                 {
+                if (!ay.keeps(y))
+                    return render_span(y, 0, W);
+                const float *src = &previous[size_t(ay.old(y)) * W];
+                for (int x = ax.lo; x < ax.hi; x += ax.stride)
+                    field.at(x, y) = src[ax.old(x)];
+                kept += keptPerRow;
+                render_span(y, 0, ax.lo);
+                if (ax.stride == 2)
+                    render_span(y, ax.lo + 1, ax.hi, 2);
+                render_span(y, ax.hi, W); }); });
+        reusedPixels = kept;
+        evaluated = size_t(W) * H - reusedPixels;
+        finish_frame(img, threads);
+        keep_view();
+        return true;
+    }
+
+    // Tiles stolen in the pool's frames; 0 if nothing ran on the pool (a
+    // mode with its own scheduler, or a cache hit).
+    uint64_t pool_steals() const { return pool ? pool->steals() : 0; }
+
+    WorkStealingPool &worker_pool(int threads) const
+    {
+        if (!pool || pool->size() != threads || pool->numa() != numa)
+            pool = std::make_unique<WorkStealingPool>(threads, numa ? &numa_plan(threads) : nullptr);
+        return *pool;
+    }
+
+    // ----- NUMA placement -----
+    const NumaPlan &numa_plan(int threads) const
+    {
+        if (!numaPlan || numaPlan->workers() != threads)
+        {
+            numaPlan = std::make_unique<NumaPlan>(NumaTopology::detect(), threads);
+            fieldPlaced = false;
+        }
+        return *numaPlan;
+    }
+
+    // Before the first NUMA frame the field (zeroed by the constructing
+    // thread) is swapped for untouched pages. Returns whether the field
+    // needs its first touch this frame.
+    bool release_field_pages() const
+    {
+        if (fieldPlaced)
+            return false;
+        decltype(field.s) fresh(field.s.size());
+        field.s.swap(fresh);
+        fieldPlaced = true;
+        return true;
+    }
+
+    // Zeroes pixels [x0, x1) of row y so their pages land on the calling
+    // thread's node; the last span of a row also covers the BMP padding.
+    void first_touch(ImageRGB &img, int y, int x0, int x1, bool touchField, bool touchImage) const
+    {
+        if (touchField)
+            std::memset(&field.s[size_t(y) * params.width + x0], 0, size_t(x1 - x0) * sizeof(float));
+        if (touchImage)
+            std::memset(img.row_ptr(y) + size_t(x0) * 3, 0, (x1 == params.width ? img.stride : size_t(x1) * 3) - size_t(x0) * 3);
+    }
+
+    // Full render with pinned workers. Each worker first-touches its share of
+    // rows, then rows and colouring are scheduled node-local first.
+    void render_numa(ImageRGB &img, int threads, bool omp) const
+    {
+        begin_frame(threads);
+        const NumaPlan &plan = numa_plan(std::max(1, threads));
+        const int H = params.height;
+        const bool touchField = release_field_pages(), touchImage = img.untouched;
+        if (touchField || touchImage)
+            run_pinned(plan, omp, [&](int w)
+                       {
+                for (int y = plan.worker_begin(w, H); y < plan.worker_begin(w + 1, H); ++y)
+                    first_touch(img, y, 0, params.width, touchField, touchImage); });
+        img.untouched = false;
+        mark("first_touch");
+
+        NumaScheduler rows(plan, H);
+        run_pinned(plan, omp, [&](int w)
+                   {
+            for (int y; rows.pop(w, y);)
+                render_row(y); });
+        numaRemoteRows = rows.remote_items();
+        mark("iterate");
+        resolve_glitches(threads);
+        mark("glitches");
+        antialias(threads);
+        mark("antialias");
+        NumaScheduler colorRows(plan, H);
+        run_pinned(plan, omp, [&](int w)
+                   {
+            for (int y; colorRows.pop(w, y);)
+                colorize_row(img, cmap, y); });
+        mark("colorize");
+    }
+
+    void render_pool(ImageRGB &img, int threads) const
+    {
+        begin_frame(threads);
+        const int tw = std::max(1, tileW), th = std::max(1, tileH);
+        const int tilesX = (params.width + tw - 1) / tw, tilesY = (params.height + th - 1) / th;
+        WorkStealingPool &wp = worker_pool(std::max(1, threads));
+        const bool touchField = numa && release_field_pages(), touchImage = numa && img.untouched;
+        if (touchField || touchImage)
+        {
+            // same tiles, dealt to the same workers as the render below
+            wp.run(tilesX * tilesY, [&](int t)
+                   {
+                int x0 = (t % tilesX) * tw, y0 = (t / tilesX) * th;
+                int x1 = std::min(params.width, x0 + tw), y1 = std::min(params.height, y0 + th);
+                for (int y = y0; y < y1; ++y)
+                    first_touch(img, y, x0, x1, touchField, touchImage); });
+            img.untouched = false;
+            mark("first_touch");
+        }
+        wp.run(tilesX * tilesY, [&](int t)
+                                              {
+            int x0 = (t % tilesX) * tw, y0 = (t / tilesX) * th;
+            int x1 = std::min(params.width, x0 + tw), y1 = std::min(params.height, y0 + th);
+            work_item(x0, y0, x1, y1, 1, [&]
+                      {
+                for (int y = y0; y < y1; ++y)
+                    render_span(y, x0, x1); }); });
+        finish_frame(img, threads);
+    }
+
+    // ----- Mariani-Silver subdivision -----
+    // Evaluates only the border of a rectangle. A border that lies in a single
+    // band (all interior, or one integer escape count) is filled without
+    // iterating. Escape bands are filled by bilinear interpolation of the
+    // corners, which is only accepted if it also reproduces the border to
+    // within SubdivBandTolerance iterations. Otherwise the rectangle is split
+    // along its longer side and the halves share the split line. Border rows
+    // and the smallest rectangles go through the frame's span kernel (SIMD
+    // when selected); tiles are independent and run on the chosen backend.
+    static constexpr int SubdivTile = 64;
+    static constexpr int SubdivMinSize = 6;
+    static constexpr float SubdivBandTolerance = 0.01f;
+
+    struct SubdivFrame
+    {
+        decltype(IterField::s) &field; // the renderer's iteration field
+        std::vector<uint8_t> done; // pixel evaluated or filled
+    };
+
+    double eval_pixel(int x, int y, uint64_t &iters) const
+    {
+        if (deep)
+            return deep->eval(x, y, iters);
+        return (this->*pointKernel)(x, y, iters);
+    }
+
+    inline float subdiv_eval(SubdivFrame &f, int x, int y, size_t &evals, uint64_t &iters) const
+    {
+        size_t i = size_t(y) * params.width + x;
+        if (!f.done[i])
+        {
+            f.field[i] = (float)eval_pixel(x, y, iters);
+            f.done[i] = 1;
+            ++evals;
+        }
+        return f.field[i];
+    }
+
+    // Pixels x0..x1 of row y not evaluated yet, in runs through the span kernel.
+    void subdiv_span(SubdivFrame &f, int y, int x0, int x1, size_t &evals) const
+    {
+        uint8_t *done = &f.done[size_t(y) * params.width];
+        for (int x = x0; x <= x1;)
+        {
+            if (done[x])
+            {
+                ++x;
+                continue;
+            }
+            int e = x;
+            while (e <= x1 && !done[e])
+                done[e++] = 1;
+            render_span(y, x, e);
+            evals += size_t(e - x);
+            x = e;
+        }
+    }
+
+    // Inclusive bounds [x0,x1] x [y0,y1].
+    void subdiv_rect(SubdivFrame &f, int x0, int y0, int x1, int y1, size_t &evals, uint64_t &iters) const
+    {
+        const int maxIter = params.maxIter;
+        int band = -1;
+        bool uniform = true;
+        auto visit = [&](int x, int y)
+        {
+            float s = subdiv_eval(f, x, y, evals, iters);
+            int b = s >= maxIter ? maxIter : (int)std::floor(s);
+            if (deep && deep->glitched[size_t(y) * params.width + x])
+                uniform = false; // value is a placeholder until re-referenced
+            if (band < 0)
+                band = b;
+            else if (b != band)
+                uniform = false;
+        };
+        subdiv_span(f, y0, x0, x1, evals);
+        subdiv_span(f, y1, x0, x1, evals);
+        for (int x = x0; x <= x1; ++x)
+        {
+            visit(x, y0);
+            visit(x, y1);
+        }
+        for (int y = y0 + 1; y < y1; ++y)
+        {
+            visit(x0, y);
+            visit(x1, y);
+        }
+        if (x1 - x0 < 2 || y1 - y0 < 2)
+            return; // no interior
+
+        const int W = params.width;
+        const float c00 = f.field[size_t(y0) * W + x0], c10 = f.field[size_t(y0) * W + x1];
+        const float c01 = f.field[size_t(y1) * W + x0], c11 = f.field[size_t(y1) * W + x1];
+        auto bilinear = [&](int x, int y)
+        {
+            float u = float(x - x0) / float(x1 - x0), v = float(y - y0) / float(y1 - y0);
+            return (c00 + (c10 - c00) * u) * (1 - v) + (c01 + (c11 - c01) * u) * v;
+        };
+        if (uniform && band < maxIter)
+        {
+            auto off = [&](int x, int y)
+            { return std::fabs(f.field[size_t(y) * W + x] - bilinear(x, y)) > SubdivBandTolerance; };
+            for (int x = x0 + 1; x < x1 && uniform; ++x)
+                uniform = !off(x, y0) && !off(x, y1);
+            for (int y = y0 + 1; y < y1 && uniform; ++y)
+                uniform = !off(x0, y) && !off(x1, y);
+        }
+        if (uniform)
+        {
+            for (int y = y0 + 1; y < y1; ++y)
+                for (int x = x0 + 1; x < x1; ++x)
+                {
+                    size_t i = size_t(y) * W + x;
+                    f.field[i] = band >= maxIter ? (float)maxIter : bilinear(x, y);
+                    f.done[i] = 1;
+                }
+            return;
+        }
+        if (x1 - x0 <= SubdivMinSize && y1 - y0 <= SubdivMinSize)
+        {
+            for (int y = y0 + 1; y < y1; ++y)
+                subdiv_span(f, y, x0 + 1, x1 - 1, evals);
+            return;
+        }
+        if (x1 - x0 >= y1 - y0)
+        {
+            int xm = (x0 + x1) / 2;
+            subdiv_rect(f, x0, y0, xm, y1, evals, iters);
+            subdiv_rect(f, xm, y0, x1, y1, evals, iters);
+        }
+        else
+        {
+            int ym = (y0 + y1) / 2;
+            subdiv_rect(f, x0, y0, x1, ym, evals, iters);
+            subdiv_rect(f, x0, ym, x1, y1, evals, iters);
+        }
+    }
+
+    // Returns the number of pixels actually iterated.
+    size_t render_mariani(ImageRGB &img, int threads, Backend backend) const
+    {
+        begin_frame(threads);
+        const int W = params.width, H = params.height;
+        SubdivFrame f{field.s, std::vector<uint8_t>(size_t(W) * H, 0)};
+        const int tilesX = (W + SubdivTile - 1) / SubdivTile, tilesY = (H + SubdivTile - 1) / SubdivTile;
+        std::atomic<size_t> evaluated{0};
+        run_on(backend, tilesX * tilesY, threads, [&](int t)
+               {
+            int x0 = (t % tilesX) * SubdivTile, y0 = (t / tilesX) * SubdivTile;
+            int x1 = std::min(W, x0 + SubdivTile) - 1, y1 = std::min(H, y0 + SubdivTile) - 1;
+            size_t evals = 0;
+            work_item(x0, y0, x1 + 1, y1 + 1, 1, [&]
+                      {
+                uint64_t iters = 0;
+                subdiv_rect(f, x0, y0, x1, y1, evals, iters);
+                count_iterations(iters); });
+            evaluated += evals; });
+        finish_frame(img, threads);
+        return evaluated.load();
+    }
+
+    // ----- Distance-estimator block fill -----
+    // Every block of a DistanceTile tile is first evaluated at its centre
+    // pixel with the distance estimate. The true distance to the set is at
+    // least a quarter of the estimate (Koebe). When that bound reaches the
+    // block's farthest corner the block lies wholly outside the set, and when
+    // half the escape band radius does too, the centre's smooth value and
+    // gradient (first order) are checked against the four corners, and fill
+    // the block if each corner lies within DistanceFillTolerance iterations.
+    // Otherwise the block is quartered; blocks of DistanceMinBlock pixels or
+    // less are rendered with the frame's span kernel, after per-pixel
+    // estimates if the distance channel is kept. Formulas or tiers without an
+    // estimator render in full.
+    static constexpr int DistanceTile = 64;
+    static constexpr int DistanceMinBlock = 4;
+    static constexpr double DistanceFillFraction = 0.25;
+    static constexpr double DistanceBandFraction = 0.5;
+    static constexpr double DistanceFillTolerance = 0.001;
+
+    struct DistanceFrame
+    {
+        double pixelRe, pixelIm;   // complex size of one pixel step in x and y
+        std::vector<uint8_t> done; // pixel evaluated or filled
+    };
+
+    inline void distance_eval(DistanceFrame &f, int x, int y, DistanceSample &d, size_t &evals, uint64_t &iters) const
+    {
+        const size_t i = size_t(y) * params.width + x;
+        d = (this->*distanceKernel)(x, y, iters);
+        field.s[i] = (float)d.smooth;
+        if (distanceChannel)
+            distance[i] = float(d.distance / f.pixelRe);
+        f.done[i] = 1;
+        ++evals;
+    }
+
+    // Half-open bounds [x0,x1) x [y0,y1).
+    void distance_block(DistanceFrame &f, int x0, int y0, int x1, int y1, size_t &evals, uint64_t &iters) const
+    {
+        const int W = params.width;
+        DistanceSample d;
+        if (x1 - x0 <= DistanceMinBlock && y1 - y0 <= DistanceMinBlock)
+        {
+            // Probed pixels were counted already; the span kernel still
+            // overwrites their smooth value, as under -ffast-math the
+            // estimator's orbit can round differently near the set.
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    if (f.done[size_t(y) * W + x])
+                        continue;
+                    if (distanceChannel)
+                        distance_eval(f, x, y, d, evals, iters);
+                    else
+                        ++evals;
+                }
+                render_span(y, x0, x1);
+            }
+            return;
+        }
+        const int cx = (x0 + x1 - 1) / 2, cy = (y0 + y1 - 1) / 2;
+        distance_eval(f, cx, cy, d, evals, iters);
+        const double reach = std::hypot(std::max(cx - x0, x1 - 1 - cx) * f.pixelRe, std::max(cy - y0, y1 - 1 - cy) * f.pixelIm);
+        // y grows downwards while Im(c) grows upwards
+        const double stepX = d.gradRe * f.pixelRe, stepY = -d.gradIm * f.pixelIm;
+        bool fill = d.distance * DistanceFillFraction >= reach && d.band * DistanceBandFraction >= reach;
+        for (int k = 0; fill && k < 4; ++k)
+        {
+            const int x = k & 1 ? x1 - 1 : x0, y = k & 2 ? y1 - 1 : y0;
+            const size_t i = size_t(y) * W + x;
+            DistanceSample corner;
+            if (!f.done[i])
+                distance_eval(f, x, y, corner, evals, iters);
+            fill = std::abs(d.smooth + (x - cx) * stepX + (y - cy) * stepY - field.s[i]) <= DistanceFillTolerance;
+        }
+        if (fill)
+        {
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x)
+                {
+                    const size_t i = size_t(y) * W + x;
+                    const double s = d.smooth + (x - cx) * stepX + (y - cy) * stepY;
+                    field.s[i] = (float)std::min(s, double(params.maxIter));
+                    if (distanceChannel)
+                        distance[i] = float(std::max(0.0, d.distance - std::hypot((x - cx) * f.pixelRe, (y - cy) * f.pixelIm)) / f.pixelRe);
+                    f.done[i] = 1;
+                }
+            ++distanceBlocks;
+            return;
+        }
+        const int xm = (x0 + x1) / 2, ym = (y0 + y1) / 2;
+        if (xm > x0 && ym > y0)
+            distance_block(f, x0, y0, xm, ym, evals, iters);
+        if (ym > y0)
+            distance_block(f, xm, y0, x1, ym, evals, iters);
+        if (xm > x0)
+            distance_block(f, x0, ym, xm, y1, evals, iters);
+        distance_block(f, xm, ym, x1, y1, evals, iters);
+    }
+
+    // Returns the number of pixels actually iterated.
+    size_t render_distance(ImageRGB &img, int threads) const
+    {
+        begin_frame(threads);
+        const int W = params.width, H = params.height;
+        if (!distanceKernel)
+        {
+            parallel_for(H, threads, 4, [&](int y)
+                         { render_row(y); });
+            finish_frame(img, threads);
+            return size_t(W) * H;
+        }
+        if (distanceChannel)
+            distance.resize(size_t(W) * H);
+        DistanceFrame f{(mapper.xMax - mapper.xMin) / double(mapper.width - 1),
+                        (mapper.yMax - mapper.yMin) / double(mapper.height - 1), std::vector<uint8_t>(size_t(W) * H, 0)};
+        const int tilesX = (W + DistanceTile - 1) / DistanceTile, tilesY = (H + DistanceTile - 1) / DistanceTile;
+        std::atomic<size_t> evaluated{0};
+        parallel_for(tilesX * tilesY, threads, 1, [&](int t)
+                     {
+            int x0 = (t % tilesX) * DistanceTile, y0 = (t / tilesX) * DistanceTile;
+            int x1 = std::min(W, x0 + DistanceTile), y1 = std::min(H, y0 + DistanceTile);
+            size_t evals = 0;
+            work_item(x0, y0, x1, y1, 1, [&]
+                      {
+                uint64_t iters = 0;
+                distance_block(f, x0, y0, x1, y1, evals, iters);
+                count_iterations(iters); });
+            evaluated += evals; });
+        finish_frame(img, threads);
+        return evaluated.load();
+    }
+
+    // ----- Progressive refinement -----
+    // Passes on grids of step 4, 2 and 1 pixels. Each pass evaluates the grid
+    // points that no coarser pass has, so the first is a 1/16-resolution image
+    // and each later pass refines it in place. Rows are handed out in order
+    // and none is started past the deadline; every pixel not reached then
+    // takes the value of the finest evaluated grid point covering it. The
+    // deadline covers coloring too: iteration stops early by the colorize
+    // time, estimated from a few sample rows.
+    static constexpr int ProgressiveSteps[] = {4, 2, 1};
+
+    size_t render_progressive(ImageRGB &img, int threads) const
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        auto deadline = start + std::chrono::microseconds(int64_t(deadlineMs * 1000.0));
+        if (deadlineMs > 0.0)
+        {
+            const int sample = std::min(params.height, 16);
+            for (int y = 0; y < sample; ++y)
+                colorize_row(img, cmap, y);
+            auto perRow = (Clock::now() - start) / sample;
+            deadline -= perRow * ((params.height + threads - 1) / std::max(1, threads));
+        }
+        begin_frame(threads);
+        const int W = params.width, H = params.height;
+        std::vector<uint8_t> done(size_t(W) * H, 0);
+        std::atomic<bool> stopped{false};
+        std::atomic<size_t> evaluated{0};
+        progressiveStep = 0;
+
+        for (int step : ProgressiveSteps)
+        {
+            const bool coarsest = step == ProgressiveSteps[0];
+            const int rows = (H + step - 1) / step;
+            parallel_for(rows, threads, 1, [&](int r)
+                         {
+                if (stopped.load(std::memory_order_relaxed))
+                    return;
+                if (deadlineMs > 0.0 && Clock::now() >= deadline)
+                {
+                    stopped = true;
+                    return;
+                }
+                const int y = r * step;
+                // rows on the coarser grid already hold every other point
+                const int xStep = coarsest || y % (2 * step) != 0 ? step : 2 * step;
+                const int x0 = coarsest || y % (2 * step) != 0 ? 0 : step;
+                uint8_t *d = &done[size_t(y) * W];
+                work_item(x0, y, W, y + 1, xStep, [&]
+                          { render_span(y, x0, W, xStep); });
+                size_t n = 0;
+                for (int x = x0; x < W; x += xStep, ++n)
+                    d[x] = 1;
+                evaluated += n; });
+            if (stopped)
+                break;
+            progressiveStep = step;
+        }
+
+        mark("iterate");
+        if (stopped)
+        {
+            fill_unevaluated(done, threads);
+            mark("fill");
+        }
+        else
+        {
+            resolve_glitches(threads);
+            mark("glitches");
+            antialias(threads);
+            mark("antialias");
+            keep_view();
+        }
+        colorize(img, cmap, threads);
+        mark("colorize");
+        return evaluated.load();
+    }
+
+    void fill_unevaluated(const std::vector<uint8_t> &done, int threads) const
+    {
+        const int W = params.width, H = params.height;
+        const int coarse = ProgressiveSteps[0];
+        // rows complete as a whole, so if the coarse pass was cut short its
+        // missing rows borrow the nearest completed coarse row above
+        std::vector<int> coarseRow(H, -1);
+        for (int y = 0, last = -1; y < H; y += coarse)
+            coarseRow[y] = last = done[size_t(y) * W] ? y : last;
+        parallel_for(H, threads, 8, [&](int y)
+                     {
+            for (int x = 0; x < W; ++x)
+            {
+                if (done[size_t(y) * W + x])
+                    continue;
+                int ax = x, ay = y;
+                for (int step = 2; step <= coarse && !done[size_t(ay) * W + ax]; step *= 2)
+                {
+                    ax = x - x % step;
+                    ay = y - y % step;
+                }
+                if (!done[size_t(ay) * W + ax])
+                    ay = coarseRow[ay];
+                field.at(x, y) = ay >= 0 ? field.at(ax, ay) : (float)params.maxIter;
+            } });
+    }
+};
+
+static PaletteType parse_palette(const std::string &s)
+{
+    if (s == "smooth")
+        return PaletteType::Smooth;
+    if (s == "original")
+        return PaletteType::Original;
+    if (s == "fire")
+        return PaletteType::Fire;
+    if (s == "bw")
+        return PaletteType::BW;
+    if (s == "gradient")
+        return PaletteType::Gradient;
+    if (s == "banded")
+        return PaletteType::Banded;
+    return PaletteType::Smooth;
+}
+
+static void split_csv(const std::string &s, std::vector<std::string> &out)
+{
+    out.clear();
+    size_t i = 0;
+    while (i < s.size())
+    {
+        size_t j = s.find(',', i);
+        if (j == std::string::npos)
+        {
+            out.push_back(s.substr(i));
+            break;
+        }
+        out.push_back(s.substr(i, j - i));
+        i = j + 1;
+    }
+}
+
+// --------------------------- CLI Parsing ---------------------------
+static bool parse_int(const char *s, int &out)
+{
+    char *e = nullptr;
+    long v = strtol(s, &e, 10);
+    if (!s || *e)
+        return false;
+    out = (int)v;
+    return true;
+}
+static bool parse_double(const char *s, double &out)
+{
+    char *e = nullptr;
+    double v = strtod(s, &e);
+    if (!s || *e)
+        return false;
+    out = v;
+    return true;
+}
+
+struct Options
+{
+    FractalParams p;
+    Backend backend = Backend::Auto;
+    bool simd = false; // vector kernel on top of the chosen backend
+    RenderMode mode = RenderMode::Full;
+    double deadlineMs = 0.0; // progressive mode time budget
+    std::string distanceOut; // PFM of the distance estimate (distance mode)
+    int aaSamples = 0;       // adaptive anti-aliasing samples per edge pixel
+    double aaThreshold = 1.0;
+    int tileW = 64, tileH = 16;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string out = "fractal.bmp";
+    bool bmpNative = false; // render straight into BMP pixel layout
+    bool numa = false;      // pin workers and place rows on their NUMA node
+    std::string profile;    // per-frame instrumentation report (JSON), "-" = stdout
+    std::string heatmap;    // BMP of render cost per pixel
+
+    // out-of-core: render in bands of `bandRows`, stream them to a BigTIFF
+    bool outOfCore = false;
+    int bandRows = 256;
+    int inflight = 2; // also the frames queued for the encoder in --animate
+
+    // pyramid: every power-of-two level as --tile-size tiles (Deep Zoom)
+    std::string pyramid;
+
+    // animation: keyframe file, frame count, GIF frame rate
+    std::string animate;
+    int frames = 60;
+    int fps = 25;
+
+    PaletteType palette = PaletteType::Smooth;
+    std::vector<RGB> colors; // for gradient/banded
+    std::vector<int> widths; // for banded
+    double feather = 1.0;
+    double hue_off = 0.0, sat = 1.0, val = 1.0;
+
+    // extra palettes applied to the same iteration field after the render
+    std::vector<std::pair<PaletteType, std::string>> recolor;
+
+    // bench subcommand: scenes x backends x thread counts
+    std::vector<std::string> scenes;   // empty = all
+    std::vector<std::string> backends; // "<backend>[+simd]"; empty = serial + auto
+    std::vector<int> threadList;       // empty = {threads}
+    int warmup = 1, reps = 5;
+    std::string json; // "-" = stdout
+
+    // serve subcommand: XYZ tiles over HTTP
+    int port = 8080;        // on 127.0.0.1
+    std::string socketPath; // Unix socket instead of TCP
+    int tileSize = 256;
+    int cacheMB = 64; // encoded tiles kept in memory
+    std::string bindAddr = "127.0.0.1"; // also for `coordinate`
+
+    // coordinate/worker subcommands: tiles rendered by other processes
+    std::string connect;      // worker: coordinator host:port
+    double workerTimeout = 0; // seconds per tile before a worker is dropped, 0 = never
+
+    // on-disk cache of iteration fields shared between runs
+    std::string cacheDir; // empty = off
+    int cacheMaxMB = 1024;
+    std::string incremental; // state file with the last full frame, empty = off
+    int panX = 0, panY = 0;  // --pan: pixels from that frame's centre
+    int zoomStep = 0;        // --zoom: +1 in, -1 out by 2x from that frame
+};
+
+static Backend parse_backend(const std::string &s, bool &simd)
+{
+    // "<backend>+simd" runs the vector kernel under that backend; plain "simd"
+    // does the same with the auto-selected parallel backend.
+    const std::string suffix = "+simd";
+    simd = false;
+    if (s == "simd")
+    {
+        simd = true;
+        return Backend::Auto;
+    }
+    if (s.size() > suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0)
+    {
+        simd = true;
+        bool unused;
+        return parse_backend(s.substr(0, s.size() - suffix.size()), unused);
+    }
+    if (s == "auto")
+        return Backend::Auto;
+    if (s == "omp")
+        return Backend::Omp;
+    if (s == "threads")
+        return Backend::Threads;
+    if (s == "serial")
+        return Backend::Serial;
+    if (s == "pool")
+        return Backend::Pool;
+    return Backend::Auto;
+}
+
+static DeepMode parse_deep(const std::string &s)
+{
+    if (s == "on")
+        return DeepMode::On;
+    if (s == "off")
+        return DeepMode::Off;
+    return DeepMode::Auto;
+}
+
+static Precision parse_precision(const std::string &s)
+{
+    if (s == "float")
+        return Precision::Float;
+    if (s == "double")
+        return Precision::Double;
+    if (s == "dd" || s == "double-double")
+        return Precision::DoubleDouble;
+    return Precision::Auto;
+}
+
+static FractalType parse_type(const std::string &s)
 {
     if (s == "julia")
         return FractalType::Julia;
+    if (s == "burningship" || s == "burning-ship" || s == "ship")
+        return FractalType::BurningShip;
+    if (s == "tricorn")
+        return FractalType::Tricorn;
+    if (s == "multibrot")
+        return FractalType::Multibrot;
     return FractalType::Mandelbrot;
 }
 
-static void print_help()
+static std::string fractal_name(const FractalParams &p)
+{
+    switch (p.type)
+    {
+    case FractalType::Julia:
+        return "Julia";
+    case FractalType::BurningShip:
+        return "Burning Ship";
+    case FractalType::Tricorn:
+        return "Tricorn";
+    case FractalType::Multibrot:
+        return "Multibrot z^" + std::to_string(p.power);
+    default:
+        return "Mandelbrot";
+    }
+}
+
+static void print_help()
+{
+    std::cout <<
+        R"(Usage: mandelbrot [options]
+       mandelbrot bench [options]   time named scenes, see "Benchmark" below
+       mandelbrot serve [options]   XYZ tile server, see "Tile server" below
+       mandelbrot coordinate [options]  render with worker processes, see "Distributed" below
+       mandelbrot worker --connect <host:port>
+  --w <int>               image width (default 1920)
+  --h <int>               image height (default 1080)
+  --maxiter <int>         max iterations (default 1000)
+  --cx <float>            center X (default -0.75)
+  --cy <float>            center Y (default 0.0)
+  --scale <float>         half-width in complex plane (default 1.5)
+  --deep <auto|on|off>    perturbation deep zoom (auto below double precision)
+                          --cx/--cy are read at full precision in deep mode
+  --series <on|off>       series-approximation iteration skip (deep mode, default on)
+  --interior <on|off>     cardioid/bulb tests and cycle detection (default on)
+  --precision <auto|float|double|dd>  kernel scalar type; auto picks float for shallow
+                          views, double below, double-double past double with --deep off
+  --type <mandelbrot|julia|burningship|tricorn|multibrot> (default mandelbrot)
+  --power <int>           Multibrot degree d in z^d + c, 2..8 (default 3)
+  --jre <float>           Julia c real (default -0.8)
+  --jim <float>           Julia c imag (default 0.156)
+  --threads <int>         CPU threads (default HW concurrency)
+  --tile <w>[x<h>]        tile size for the pool backend (default 64x16)
+  --mode <full|mariani|progressive|distance>  full per-pixel render, Mariani-Silver
+                          subdivision, coarse-to-fine passes (1/16 resolution first), or
+                          distance-estimator block fill (mandelbrot, julia, multibrot)
+  --distance-out <file.pfm>  save the distance estimate in pixels, 0 inside the set
+                          (implies --mode distance)
+  --aa <samples>          adaptive anti-aliasing: re-sample edge pixels on a jittered
+                          k x k subpixel grid (4, 9, 16, ...; default 0 = off)
+  --aa-threshold <float>  3x3 std-dev of iteration counts that marks an edge (default 1)
+  --deadline-ms <float>   progressive render budget; stops at the deadline and writes the
+                          best image so far (implies --mode progressive)
+  --backend <auto|omp|threads|serial|pool|simd> (default auto)
+                          append +simd (e.g. omp+simd) for the AVX2/AVX-512 kernel
+   --palette <smooth|original|fire|bw|gradient|banded>
+  --colors  <#RRGGBB,#RRGGBB,...>  (for gradient/banded)
+  --widths  <w1,w2,...>            (for banded; default all 12)
+  --feather <0..1>                 (banded softness, default 1)
+  --hue <float>  --sat <float>  --val <float>  (global HSV tweaks)
+  --out <filename.bmp>    output image (default fractal.bmp); a .png name writes PNG, deflated
+                          in parallel chunks
+  --bmp-native            keep pixels in BMP layout (BGR, bottom-up) so saving is a flush
+  --cache-dir <dir>       reuse iteration fields of identical earlier renders (any palette);
+                          shared safely between processes
+  --cache-max-mb <int>    evict least recently used cache entries past this size (default 1024)
+  --incremental <file>    keep the last full frame in <file>; a pan by whole pixels or a 2x zoom
+                          from it renders only the pixels not already there
+  --pan <dx,dy>           with --incremental: view the last frame moved by dx,dy pixels (y down)
+  --zoom <in|out>         with --incremental: view the last frame zoomed 2x, centre snapped so
+                          pixels line up (combines with --pan; --cx/--cy/--scale are ignored)
+  --numa                  pin workers per NUMA node; each node first-touches and renders its
+                          own rows (full mode, omp/threads/pool backends)
+  --profile <file|->      time every row/tile and write per-thread iterations, escaped vs
+                          interior pixels, busy/idle time and phase times as JSON
+  --heatmap <file.bmp>    also save the render cost per row/tile as a heat map
+  --out-of-core           render in bands streamed to a BigTIFF (or a .png) at --out (no 4 GB limit)
+  --band <rows>           band height for --out-of-core (default 256)
+  --inflight <int>        finished bands/frames allowed to wait for the writer (default 2)
+  --pyramid <name>        render once, write every power-of-two level as PNG tiles:
+                          <name>.dzi + <name>_files/<level>/<col>_<row>.png (Deep Zoom);
+                          tiles of --tile-size (default 256), --out-of-core renders in bands
+  --animate <keys.txt>    render a zoom along keyframes, one per line:
+                          <cx> <cy> <scale> [maxiter] [palette]
+  --frames <int>          frames in the animation (default 60)
+  --fps <int>             GIF frame rate (default 25)
+                          --out: anim.gif, frame_%04d.bmp (or .png), or - for raw RGB24 on stdout
+  --recolor <palette>:<file.bmp>  also save the same frame in another palette
+                          (re-colors the kept iteration field; repeatable)
+
+Benchmark (mandelbrot bench):
+  --scenes <a,b,...>      full, seahorse, interior, julia (default all)
+  --backends <a,b,...>    backends as for --backend (default serial,auto)
+  --thread-list <n,...>   thread counts to sweep (default --threads)
+  --warmup <int>          untimed renders per case (default 1)
+  --reps <int>            timed renders per case (default 5)
+  --json <file|->         also write the results as JSON
+
+Tile server (mandelbrot serve): GET /z/x/y.bmp, GET /stats; Ctrl+C stops
+  --port <int>            TCP port (default 8080)
+  --bind <addr>           IPv4 address to listen on (default 127.0.0.1, 0.0.0.0 = all)
+  --socket <path>         listen on a Unix socket instead
+  --tile-size <px>        tile width and height (default 256)
+  --cache-mb <int>        LRU cache of encoded tiles (default 64)
+  --threads <int>         tile render workers shared by all connections
+  The z = 0 tile is the square of half-width --scale around --cx/--cy.
+
+Distributed (mandelbrot coordinate): the render options above define the frame
+  --port, --bind, --socket  where workers connect, as for serve
+  --tile-size <px>        tile width and height handed to workers (default 256)
+  --worker-timeout <s>    drop a worker that holds one tile longer (default 0 = never)
+  --out <file>            assembled image; .tif/.tiff writes BigTIFF, .png PNG, otherwise BMP
+Worker (mandelbrot worker): renders tiles for a coordinator until it is done
+  --connect <host:port>   coordinator address (or --socket <path>)
+  --threads <int>         render threads of this worker; --numa also applies
+)";
+}
+
+static bool parse_opts(int argc, char **argv, Options &o)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        auto need = [&](int i)
+        { return (i + 1 < argc); };
+        if (a == "--help" || a == "-h")
+        {
+            print_help();
+            return false;
+        }
+        else if (a == "--w" && need(i))
+            parse_int(argv[++i], o.p.width);
+        else if (a == "--h" && need(i))
+            parse_int(argv[++i], o.p.height);
+        else if (a == "--maxiter" && need(i))
+            parse_int(argv[++i], o.p.maxIter);
+        else if (a == "--cx" && need(i))
+        {
+            o.p.centerXStr = argv[++i];
+            parse_double(argv[i], o.p.centerX);
+        }
+        else if (a == "--cy" && need(i))
+        {
+            o.p.centerYStr = argv[++i];
+            parse_double(argv[i], o.p.centerY);
+        }
+        else if (a == "--deep" && need(i))
+            o.p.deep = parse_deep(argv[++i]);
+        else if (a == "--precision" && need(i))
+            o.p.precision = parse_precision(argv[++i]);
+        else if (a == "--interior" && need(i))
+            o.p.interiorChecks = std::string(argv[++i]) != "off";
+        else if (a == "--series" && need(i))
+            o.p.series = std::string(argv[++i]) != "off";
+        else if (a == "--scale" && need(i))
+            parse_double(argv[++i], o.p.scale);
+        else if (a == "--type" && need(i))
+            o.p.type = parse_type(argv[++i]);
+        else if (a == "--power" && need(i))
+            parse_int(argv[++i], o.p.power);
+        else if (a == "--jre" && need(i))
+            parse_double(argv[++i], o.p.juliaRe);
+        else if (a == "--jim" && need(i))
+            parse_double(argv[++i], o.p.juliaIm);
+        else if (a == "--threads" && need(i))
+            parse_int(argv[++i], o.threads);
+        else if (a == "--backend" && need(i))
+            o.backend = parse_backend(argv[++i], o.simd);
+        else if (a == "--tile" && need(i))
+        {
+            std::string v = argv[++i];
+            size_t xpos = v.find('x');
+            parse_int(v.substr(0, xpos).c_str(), o.tileW);
+            o.tileH = o.tileW;
+            if (xpos != std::string::npos)
+                parse_int(v.substr(xpos + 1).c_str(), o.tileH);
+        }
+        else if (a == "--mode" && need(i))
+        {
+            std::string m = argv[++i];
+            o.mode = m == "mariani" ? RenderMode::Mariani : m == "progressive" ? RenderMode::Progressive : m == "distance" ? RenderMode::Distance : RenderMode::Full;
+        }
+        else if (a == "--aa" && need(i))
+            parse_int(argv[++i], o.aaSamples);
+        else if (a == "--aa-threshold" && need(i))
+            parse_double(argv[++i], o.aaThreshold);
+        else if (a == "--deadline-ms" && need(i))
+        {
+            parse_double(argv[++i], o.deadlineMs);
+            o.mode = RenderMode::Progressive;
+        }
+        else if (a == "--distance-out" && need(i))
+        {
+            o.distanceOut = argv[++i];
+            o.mode = RenderMode::Distance;
+        }
+        else if (a == "--bmp-native")
+            o.bmpNative = true;
+        else if (a == "--cache-dir" && need(i))
+            o.cacheDir = argv[++i];
+        else if (a == "--cache-max-mb" && need(i))
+            parse_int(argv[++i], o.cacheMaxMB);
+        else if (a == "--incremental" && need(i))
+            o.incremental = argv[++i];
+        else if (a == "--pan" && need(i))
+        {
+            if (std::sscanf(argv[++i], "%d,%d", &o.panX, &o.panY) != 2)
+                std::cerr << "Invalid --pan: " << argv[i] << "\n";
+        }
+        else if (a == "--zoom" && need(i))
+        {
+            std::string z = argv[++i];
+            if (z == "in" || z == "out")
+                o.zoomStep = z == "in" ? 1 : -1;
+            else
+                std::cerr << "Invalid --zoom: " << z << "\n";
+        }
+        else if (a == "--numa")
+            o.numa = true;
+        else if (a == "--profile" && need(i))
+            o.profile = argv[++i];
+        else if (a == "--heatmap" && need(i))
+            o.heatmap = argv[++i];
+        else if (a == "--out-of-core")
+            o.outOfCore = true;
+        else if (a == "--band" && need(i))
+            parse_int(argv[++i], o.bandRows);
+        else if (a == "--inflight" && need(i))
+            parse_int(argv[++i], o.inflight);
+        else if (a == "--pyramid" && need(i))
+            o.pyramid = argv[++i];
+        else if (a == "--scenes" && need(i))
+            split_csv(argv[++i], o.scenes);
+        else if (a == "--backends" && need(i))
+            split_csv(argv[++i], o.backends);
+        else if (a == "--thread-list" && need(i))
+        {
+            std::vector<std::string> list;
+            split_csv(argv[++i], list);
+            o.threadList.clear();
+            for (const auto &t : list)
+            {
+                int n = 0;
+                if (parse_int(t.c_str(), n) && n > 0)
+                    o.threadList.push_back(n);
+            }
+        }
+        else if (a == "--warmup" && need(i))
+            parse_int(argv[++i], o.warmup);
+        else if (a == "--reps" && need(i))
+            parse_int(argv[++i], o.reps);
+        else if (a == "--json" && need(i))
+            o.json = argv[++i];
+        else if (a == "--port" && need(i))
+            parse_int(argv[++i], o.port);
+        else if (a == "--socket" && need(i))
+            o.socketPath = argv[++i];
+        else if (a == "--tile-size" && need(i))
+            parse_int(argv[++i], o.tileSize);
+        else if (a == "--cache-mb" && need(i))
+            parse_int(argv[++i], o.cacheMB);
+        else if (a == "--bind" && need(i))
+            o.bindAddr = argv[++i];
+        else if (a == "--connect" && need(i))
+            o.connect = argv[++i];
+        else if (a == "--worker-timeout" && need(i))
+            parse_double(argv[++i], o.workerTimeout);
+        else if (a == "--animate" && need(i))
+            o.animate = argv[++i];
+        else if (a == "--frames" && need(i))
+            parse_int(argv[++i], o.frames);
+        else if (a == "--fps" && need(i))
+            parse_int(argv[++i], o.fps);
+        else if (a == "--out" && need(i))
+            o.out = argv[++i];
+        else if (a == "--recolor" && need(i))
+        {
+            std::string v = argv[++i];
+            size_t colon = v.find(':');
+            if (colon == std::string::npos)
+                std::cerr << "[warn] --recolor expects <palette>:<file.bmp>; ignoring\n";
+            else
+                o.recolor.emplace_back(parse_palette(v.substr(0, colon)), v.substr(colon + 1));
+        }
+        else if (a == "--palette" && need(i))
+            o.palette = parse_palette(argv[++i]);
+        else if (a == "--colors" && need(i))
+        {
+            std::vector<std::string> toks;
+            split_csv(argv[++i], toks);
+            o.colors.clear();
+            for (auto &t : toks)
+            {
+                RGB c;
+                if (parse_hex_rgb(t, c))
+                    o.colors.push_back(c);
+            }
+            if (o.colors.empty())
+                std::cerr << "[warn] --colors parse failed; ignoring\n";
+        }
+        else if (a == "--widths" && need(i))
+        {
+            std::vector<std::string> toks;
+            split_csv(argv[++i], toks);
+            o.widths.clear();
+            for (auto &t : toks)
+            {
+                int v;
+                if (parse_int(t.c_str(), v))
+                    o.widths.push_back(v);
+            }
+        }
+        else if (a == "--feather" && need(i))
+            parse_double(argv[++i], o.feather);
+        else if (a == "--hue" && need(i))
+            parse_double(argv[++i], o.hue_off);
+        else if (a == "--sat" && need(i))
+            parse_double(argv[++i], o.sat);
+        else if (a == "--val" && need(i))
+            parse_double(argv[++i], o.val);
+        else
+        {
+            std::cerr << "Unknown or incomplete option: " << a << "\n";
+            print_help();
+            return false;
+        }
+    }
+    o.p.width = std::max(1, o.p.width);
+    o.p.height = std::max(1, o.p.height);
+    o.p.maxIter = std::max(1, o.p.maxIter);
+    o.p.power = std::clamp(o.p.power, MultibrotMinPower, MultibrotMaxPower);
+    o.tileW = std::max(1, o.tileW);
+    o.tileH = std::max(1, o.tileH);
+    o.threads = std::max(1, o.threads);
+    return true;
+}
+
+static ColorMap make_colormap(const Options &opt, PaletteType palette)
+{
+    ColorMap cmap;
+    cmap.type = palette;
+    cmap.hue_offset = opt.hue_off;
+    cmap.sat_scale = opt.sat;
+    cmap.val_scale = opt.val;
+    cmap.feather = std::clamp(opt.feather, 0.0, 1.0);
+
+    if (palette == PaletteType::Gradient)
+    {
+        if (!opt.colors.empty())
+            cmap.stops = opt.colors;
+        else
+            cmap.stops = {{0, 0, 0}, {1, 1, 1}};
+    }
+    if (palette == PaletteType::Banded)
+    {
+        cmap.stops = (!opt.colors.empty() ? opt.colors
+                                          : std::vector<RGB>{{1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {0, 1, 1}, {0, 0, 1}, {1, 0, 1}});
+        cmap.widths = opt.widths; // may be empty -> defaulted in colorize
+    }
+    cmap.compile();
+    return cmap;
+}
+
+static const char *backend_name(Backend b)
+{
+    switch (b)
+    {
+    case Backend::Auto:
+        return "auto";
+    case Backend::Omp:
+        return "OpenMP";
+    case Backend::Threads:
+        return "std::thread";
+    case Backend::Serial:
+        return "serial";
+    case Backend::Pool:
+        return "work-stealing pool";
+    }
+    return "unknown";
+}
+
+static const char *mode_name(RenderMode m)
+{
+    switch (m)
+    {
+    case RenderMode::Mariani:
+        return "mariani";
+    case RenderMode::Progressive:
+        return "progressive";
+    case RenderMode::Distance:
+        return "distance";
+    default:
+        return "full";
+    }
+}
+
+static Backend resolve_backend(Backend b)
+{
+    if (b != Backend::Auto)
+        return b;
+#ifdef _OPENMP
+    return Backend::Omp;
+#else
+    return Backend::Threads;
+#endif
+}
+
+static void configure_renderer(CPURenderer &r, const Options &opt)
+{
+    r.simd = opt.simd ? detect_simd_level() : SimdLevel::Scalar;
+    r.tileW = opt.tileW;
+    r.tileH = opt.tileH;
+    r.deadlineMs = opt.deadlineMs;
+    r.aaSamples = opt.aaSamples;
+    r.aaThreshold = (float)opt.aaThreshold;
+    r.numa = opt.numa;
+    r.distanceChannel = !opt.distanceOut.empty();
+}
+
+// Renders one frame with a resolved backend; returns the pixels iterated.
+static size_t render_with(const CPURenderer &r, ImageRGB &img, Backend backend, RenderMode mode, int threads)
+{
+    if (backend == Backend::Serial)
+        threads = 1;
+    if (mode == RenderMode::Mariani)
+        return r.render_mariani(img, threads, backend);
+    if (mode == RenderMode::Progressive)
+        return r.render_progressive(img, threads);
+    if (mode == RenderMode::Distance)
+        return r.render_distance(img, threads);
+    size_t evaluated = 0;
+    if (r.incremental && r.render_incremental(img, threads, evaluated))
+        return evaluated;
+    switch (backend)
+    {
+    case Backend::Serial:
+        r.render_serial(img);
+        break;
+#ifdef _OPENMP
+    case Backend::Omp:
+        r.render_omp(img, threads);
+        break;
+#endif
+    case Backend::Pool:
+        r.render_pool(img, threads);
+        break;
+    default:
+        r.render_threads(img, threads);
+        break;
+    }
+    r.keep_view();
+    return size_t(r.params.width) * r.params.height;
+}
+
+// --------------------------- PNG Writer ---------------------------
+// 8-bit RGB PNG with its own deflate, so no zlib is needed. Every row gets
+// the filter with the smallest sum of absolute filtered bytes. Rows are cut
+// into chunks of about PngChunkBytes that are filtered and deflated in
+// parallel, pigz-style: each chunk is compressed on its own and closed with
+// an empty stored block, which byte-aligns it, so the chunks concatenate
+// into one zlib stream. Each goes out as its own IDAT, and the stream's
+// Adler-32 is combined from the chunks' sums. write_rows takes a frame band
+// by band, so encoding one band overlaps rendering of the next.
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    static const struct Table
+    {
+        uint32_t t[256];
+        Table()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+        }
+    } table;
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i)
+        crc = table.t[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static constexpr uint32_t AdlerBase = 65521;
+
+static uint32_t adler32_update(uint32_t adler, const uint8_t *p, size_t n)
+{
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (n > 0)
+    {
+        const size_t k = std::min<size_t>(n, 5552); // longest run before b can overflow
+        for (size_t i = 0; i < k; ++i)
+        {
+            a += p[i];
+            b += a;
+        }
+        a %= AdlerBase;
+        b %= AdlerBase;
+        p += k;
+        n -= k;
+    }
+    return a | (b << 16);
+}
+
+// Adler-32 of A followed by B, from adler(A), adler(B) and B's length.
+static uint32_t adler32_combine(uint32_t a1, uint32_t a2, uint64_t len2)
+{
+    const uint32_t rem = uint32_t(len2 % AdlerBase);
+    uint32_t s1 = a1 & 0xFFFF;
+    uint32_t s2 = uint32_t(uint64_t(rem) * s1 % AdlerBase);
+    s1 += (a2 & 0xFFFF) + AdlerBase - 1;
+    s2 += (a1 >> 16) + (a2 >> 16) + AdlerBase - rem;
+    return (s1 % AdlerBase) | ((s2 % AdlerBase) << 16);
+}
+
+// Raw deflate of one chunk: greedy LZ77 over hash chains, then a dynamic
+// Huffman block per BlockSymbols symbols, or stored blocks where those are
+// smaller. The output is not final and ends byte-aligned.
+class ChunkDeflater
+{
+public:
+    void compress(const uint8_t *in, size_t n, std::vector<uint8_t> &out)
+    {
+        Bits bw{out};
+        head.assign(size_t(1) << HashBits, -1);
+        prev.assign(WindowSize, -1);
+        reset_block();
+        size_t pos = 0, blockStart = 0;
+        while (pos < n)
+        {
+            int len = 0, dist = 0;
+            if (pos + MinMatch <= n)
+            {
+                len = longest_match(in, n, pos, dist);
+                insert(in, pos);
+            }
+            if (len >= MinMatch)
+            {
+                const int lc = tables().lenCode[len];
+                ++litFreq[257 + lc];
+                ++distFreq[tables().dist_code(dist)];
+                syms.push_back(uint32_t(dist) << 16 | uint32_t(len));
+                for (size_t e = pos + len; ++pos < e;)
+                    if (pos + MinMatch <= n)
+                        insert(in, pos);
+            }
+            else
+            {
+                ++litFreq[in[pos]];
+                syms.push_back(in[pos++]);
+            }
+            if (syms.size() >= BlockSymbols)
+            {
+                flush_block(in + blockStart, pos - blockStart, bw);
+                blockStart = pos;
+            }
+        }
+        if (!syms.empty())
+            flush_block(in + blockStart, pos - blockStart, bw);
+        bw.put(0, 3); // empty stored block: byte-aligns the chunk
+        bw.align();
+        out.insert(out.end(), {0x00, 0x00, 0xFF, 0xFF});
+    }
+
+private:
+    static constexpr int MinMatch = 3, MaxMatch = 258, NiceMatch = 128, MaxChain = 16;
+    static constexpr int HashBits = 15, WindowSize = 32768;
+    static constexpr size_t BlockSymbols = 32768;
+    static constexpr uint8_t ClOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    struct Tables
+    {
+        static constexpr uint16_t lenBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                                 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr uint8_t lenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr uint16_t distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                                  193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static constexpr uint8_t distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                  6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        uint8_t lenCode[MaxMatch + 1] = {};
+        uint8_t distCode[512 + 128] = {}; // distance - 1 below 512, then by (distance - 1) >> 8
+
+        Tables()
+        {
+            for (int c = 0; c < 29; ++c)
+                for (int l = lenBase[c]; l < lenBase[c] + (1 << lenExtra[c]) && l <= MaxMatch; ++l)
+                    lenCode[l] = uint8_t(c);
+            for (int c = 0; c < 30; ++c)
+                for (int d = distBase[c]; d < distBase[c] + (1 << distExtra[c]); ++d)
+                    distCode[d <= 512 ? d - 1 : 512 + ((d - 1) >> 8)] = uint8_t(c);
+        }
+        int dist_code(int d) const { return distCode[d <= 512 ? d - 1 : 512 + ((d - 1) >> 8)]; }
+    };
+    static const Tables &tables()
+    {
+        static const Tables t;
+        return t;
+    }
+
+    // LSB-first bit packing
+    struct Bits
+    {
+        std::vector<uint8_t> &out;
+        uint64_t acc = 0;
+        int n = 0;
+        void put(uint32_t v, int bits)
+        {
+            acc |= uint64_t(v) << n;
+            n += bits;
+            if (n < 32)
+                return;
+            const uint8_t b[4] = {uint8_t(acc), uint8_t(acc >> 8), uint8_t(acc >> 16), uint8_t(acc >> 24)};
+            out.insert(out.end(), b, b + 4);
+            acc >>= 32;
+            n -= 32;
+        }
+        // pads to a byte boundary and empties the accumulator
+        void align()
+        {
+            for (n = (n + 7) & ~7; n > 0; n -= 8, acc >>= 8)
+                out.push_back(uint8_t(acc));
+            acc = 0;
+        }
+    };
+
+    static uint32_t hash(const uint8_t *p)
+    {
+        const uint32_t v = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16;
+        return (v * 2654435761u) >> (32 - HashBits);
+    }
+
+    void insert(const uint8_t *in, size_t pos)
+    {
+        int32_t &h = head[hash(in + pos)];
+        prev[pos & (WindowSize - 1)] = h;
+        h = int32_t(pos);
+    }
+
+    static int match_length(const uint8_t *a, const uint8_t *b, int maxLen)
+    {
+        int l = 0;
+        if constexpr (std::endian::native == std::endian::little)
+            for (; l + 8 <= maxLen; l += 8)
+            {
+                uint64_t x, y;
+                std::memcpy(&x, a + l, 8);
+                std::memcpy(&y, b + l, 8);
+                if (x != y)
+                    return l + std::countr_zero(x ^ y) / 8;
+            }
+        while (l < maxLen && a[l] == b[l])
+            ++l;
+        return l;
+    }
+
+    int longest_match(const uint8_t *in, size_t n, size_t pos, int &dist) const
+    {
+        const int maxLen = int(std::min<size_t>(MaxMatch, n - pos));
+        const int64_t lowest = int64_t(pos) - WindowSize;
+        int best = MinMatch - 1;
+        int32_t cand = head[hash(in + pos)];
+        for (int chain = MaxChain; chain > 0 && cand >= 0 && cand > lowest; --chain)
+        {
+            if (in[cand + best] == in[pos + best])
+            {
+                const int l = match_length(in + cand, in + pos, maxLen);
+                if (l > best)
+                {
+                    best = l;
+                    dist = int(pos - cand);
+                    if (l >= NiceMatch || l >= maxLen)
+                        break;
+                }
+            }
+            const int32_t next = prev[cand & (WindowSize - 1)];
+            if (next >= cand) // slot reused by a newer position
+                break;
+            cand = next;
+        }
+        return best >= MinMatch ? best : 0;
+    }
+
+    // Code lengths of at most maxBits for the frequencies; over-long codes
+    // are avoided by flattening the frequencies and building again.
+    static void huffman_lengths(const uint32_t *freq, int n, int maxBits, uint8_t *len)
+    {
+        std::vector<uint32_t> f(freq, freq + n);
+        std::vector<std::pair<uint64_t, int>> heap;
+        std::vector<int> parent(2 * size_t(n)), depth(2 * size_t(n));
+        const auto later = std::greater<>();
+        for (;;)
+        {
+            std::fill(len, len + n, uint8_t(0));
+            heap.clear();
+            for (int i = 0; i < n; ++i)
+                if (f[i])
+                    heap.push_back({f[i], i});
+            if (heap.size() == 1)
+                len[heap[0].second] = 1;
+            if (heap.size() <= 1)
+                return;
+            std::make_heap(heap.begin(), heap.end(), later);
+            int next = n;
+            while (heap.size() > 1)
+            {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                const auto a = heap.back();
+                heap.pop_back();
+                std::pop_heap(heap.begin(), heap.end(), later);
+                const auto b = heap.back();
+                heap.pop_back();
+                parent[a.second] = parent[b.second] = next;
+                heap.push_back({a.first + b.first, next++});
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+            // parents are numbered after their children, so walk down from the root
+            depth[next - 1] = 0;
+            int longest = 0;
+            for (int i = next - 2; i >= 0; --i)
+            {
+                if (i < n && !f[i])
+                    continue;
+                depth[i] = depth[parent[i]] + 1;
+                if (i < n)
+                {
+                    len[i] = uint8_t(std::min(depth[i], 255));
+                    longest = std::max(longest, depth[i]);
+                }
+            }
+            if (longest <= maxBits)
+                return;
+            for (uint32_t &x : f)
+                if (x)
+                    x = (x >> 1) | 1;
+        }
+    }
+
+    // Canonical codes, bit-reversed for LSB-first output.
+    static void huffman_codes(const uint8_t *len, int n, uint16_t *code)
+    {
+        int count[16] = {}, next[16] = {};
+        for (int i = 0; i < n; ++i)
+            ++count[len[i]];
+        count[0] = 0;
+        for (int b = 1, c = 0; b < 16; ++b)
+            next[b] = c = (c + count[b - 1]) << 1;
+        for (int i = 0; i < n; ++i)
+        {
+            uint32_t c = uint32_t(next[len[i]]++), r = 0;
+            for (int k = 0; k < len[i]; ++k, c >>= 1)
+                r = (r << 1) | (c & 1);
+            code[i] = uint16_t(r);
+        }
+    }
+
+    void reset_block()
+    {
+        syms.clear();
+        std::fill(std::begin(litFreq), std::end(litFreq), 0u);
+        std::fill(std::begin(distFreq), std::end(distFreq), 0u);
+    }
+
+    void flush_block(const uint8_t *raw, size_t rawBytes, Bits &bw)
+    {
+        const Tables &t = tables();
+        litFreq[256] = 1; // end of block
+        if (std::all_of(std::begin(distFreq), std::end(distFreq), [](uint32_t f)
+                        { return f == 0; }))
+            distFreq[0] = 1; // decoders expect at least one distance code
+        uint8_t litLen[286], distLen[30];
+        huffman_lengths(litFreq, 286, 15, litLen);
+        huffman_lengths(distFreq, 30, 15, distLen);
+        int nLit = 286, nDist = 30;
+        while (nLit > 257 && !litLen[nLit - 1])
+            --nLit;
+        while (nDist > 1 && !distLen[nDist - 1])
+            --nDist;
+
+        // run-length code the code lengths (16: repeat previous, 17/18: zeros)
+        uint8_t lens[286 + 30];
+        std::copy(litLen, litLen + nLit, lens);
+        std::copy(distLen, distLen + nDist, lens + nLit);
+        const int total = nLit + nDist;
+        std::vector<std::pair<uint8_t, uint8_t>> rle; // symbol, extra bits value
+        uint32_t clFreq[19] = {};
+        auto emit = [&](int sym, int extra)
+        {
+            rle.push_back({uint8_t(sym), uint8_t(extra)});
+            ++clFreq[sym];
+        };
+        for (int i = 0; i < total;)
+        {
+            int run = 1;
+            while (i + run < total && lens[i + run] == lens[i])
+                ++run;
+            if (lens[i] == 0 && run >= 3)
+            {
+                run = std::min(run, 138);
+                if (run >= 11)
+                    emit(18, run - 11);
+                else
+                    emit(17, run - 3);
+            }
+            else if (lens[i] != 0 && run >= 4)
+            {
+                emit(lens[i], 0);
+                run = std::min(run - 1, 6);
+                emit(16, run - 3);
+                ++i;
+            }
+            else
+            {
+                emit(lens[i], 0);
+                run = 1;
+            }
+            i += run;
+        }
+        if (std::count_if(std::begin(clFreq), std::end(clFreq), [](uint32_t f)
+                          { return f != 0; }) < 2)
+            ++clFreq[clFreq[0] ? 1 : 0]; // a one-code length code would be incomplete
+        uint8_t clLen[19];
+        huffman_lengths(clFreq, 19, 7, clLen);
+        int nCl = 19;
+        while (nCl > 4 && !clLen[ClOrder[nCl - 1]])
+            --nCl;
+
+        static constexpr int rleExtra[3] = {2, 3, 7};
+        uint64_t bits = 3 + 14 + 3 * uint64_t(nCl);
+        for (const auto &[s, e] : rle)
+            bits += clLen[s] + (s >= 16 ? rleExtra[s - 16] : 0);
+        for (int i = 0; i < 286; ++i)
+            bits += uint64_t(litFreq[i]) * (litLen[i] + (i > 256 ? t.lenExtra[i - 257] : 0));
+        for (int i = 0; i < 30; ++i)
+            bits += uint64_t(distFreq[i]) * (distLen[i] + t.distExtra[i]);
+        const uint64_t storedBits = 8 * (rawBytes + 5 * ((rawBytes + 65534) / 65535)) + 8;
+
+        if (storedBits < bits)
+        {
+            for (size_t off = 0; off < rawBytes;)
+            {
+                const uint32_t len = uint32_t(std::min<size_t>(65535, rawBytes - off));
+                bw.put(0, 3);
+                bw.align();
+                bw.put(len, 16);
+                bw.put(~len & 0xFFFF, 16);
+                bw.out.insert(bw.out.end(), raw + off, raw + off + len);
+                off += len;
+            }
+        }
+        else
+        {
+            uint16_t litCode[286], distCodes[30], clCode[19];
+            huffman_codes(litLen, 286, litCode);
+            huffman_codes(distLen, 30, distCodes);
+            huffman_codes(clLen, 19, clCode);
+            bw.put(0, 1); // not final
+            bw.put(2, 2); // dynamic Huffman
+            bw.put(uint32_t(nLit - 257), 5);
+            bw.put(uint32_t(nDist - 1), 5);
+            bw.put(uint32_t(nCl - 4), 4);
+            for (int i = 0; i < nCl; ++i)
+                bw.put(clLen[ClOrder[i]], 3);
+            for (const auto &[s, e] : rle)
+            {
+                bw.put(clCode[s], clLen[s]);
+                if (s >= 16)
+                    bw.put(e, rleExtra[s - 16]);
+            }
+            for (uint32_t sym : syms)
+            {
+                const int dist = int(sym >> 16), v = int(sym & 0xFFFF);
+                if (dist == 0)
+                {
+                    bw.put(litCode[v], litLen[v]);
+                    continue;
+                }
+                const int lc = t.lenCode[v], dc = t.dist_code(dist);
+                bw.put(litCode[257 + lc], litLen[257 + lc]);
+                bw.put(uint32_t(v - t.lenBase[lc]), t.lenExtra[lc]);
+                bw.put(distCodes[dc], distLen[dc]);
+                bw.put(uint32_t(dist - t.distBase[dc]), t.distExtra[dc]);
+            }
+            bw.put(litCode[256], litLen[256]);
+        }
+        reset_block();
+    }
+
+    std::vector<int32_t> head, prev; // hash chains: newest position per hash, older per window slot
+    std::vector<uint32_t> syms;      // literal byte, or distance << 16 | match length
+    uint32_t litFreq[286], distFreq[30];
+};
+
+// Filters a row of n bytes (RGB) against the row above into out[0..n], with
+// the filter type in out[0]; scratch holds n bytes.
+static void png_filter_row(const uint8_t *cur, const uint8_t *above, size_t n, uint8_t *out, uint8_t *scratch)
+{
+    uint64_t best = ~uint64_t(0);
+    auto trial = [&](uint8_t type, auto predict)
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const int a = i >= 3 ? cur[i - 3] : 0, b = above[i], c = i >= 3 ? above[i - 3] : 0;
+            scratch[i] = uint8_t(cur[i] - predict(a, b, c));
+            sum += uint64_t(std::abs(int(int8_t(scratch[i]))));
+        }
+        if (sum < best)
+        {
+            best = sum;
+            out[0] = type;
+            std::memcpy(out + 1, scratch, n);
+        }
+    };
+    trial(0, [](int, int, int)
+          { return 0; });
+    trial(1, [](int a, int, int)
+          { return a; });
+    trial(2, [](int, int b, int)
+          { return b; });
+    trial(3, [](int a, int b, int)
+          { return (a + b) >> 1; });
+    trial(4, [](int a, int b, int c)
+          {
+        const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c; });
+}
+
+static constexpr size_t PngChunkBytes = size_t(256) << 10; // filtered bytes per deflate chunk
+
+class PngWriter
+{
+public:
+    ~PngWriter()
+    {
+        if (f)
+            std::fclose(f);
+    }
+
+    bool open(const std::string &path, int width, int height)
+    {
+        w = width;
+        h = height;
+        f = std::fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        uint8_t ihdr[13] = {};
+        put32(ihdr, uint32_t(w));
+        put32(ihdr + 4, uint32_t(h));
+        ihdr[8] = 8; // bits per sample
+        ihdr[9] = 2; // RGB
+        above.assign(size_t(w) * 3, 0);
+        return std::fwrite(signature, 1, 8, f) == 8 && write_chunk("IHDR", ihdr, sizeof(ihdr));
+    }
+
+    // The next `rows` rows of the frame: rows 0.. of img, filtered and
+    // deflated in chunks over `threads` threads.
+    bool write_rows(const ImageRGB &img, int rows, int threads)
+    {
+        const size_t rowBytes = size_t(w) * 3;
+        const int perChunk = int(std::max<size_t>(1, PngChunkBytes / (rowBytes + 1)));
+        const int chunks = (rows + perChunk - 1) / perChunk;
+        struct Chunk
+        {
+            std::vector<uint8_t> idat; // length, type, data, CRC
+            uint32_t adler = 1;
+            uint64_t bytes = 0; // uncompressed
+        };
+        std::vector<Chunk> out(size_t(std::max(0, chunks)));
+        const bool header = rowsWritten == 0;
+        CPURenderer::parallel_for(chunks, threads, 1, [&](int c)
+                                  {
+            const int y0 = c * perChunk, y1 = std::min(rows, y0 + perChunk);
+            std::vector<uint8_t> filtered(size_t(y1 - y0) * (rowBytes + 1)), scratch(rowBytes), rgb[2];
+            for (int y = y0; y < y1; ++y)
+            {
+                const uint8_t *prev = y == 0 ? above.data() : rgb_row(img, y - 1, rgb[(y - 1) & 1]);
+                png_filter_row(rgb_row(img, y, rgb[y & 1]), prev, rowBytes, &filtered[size_t(y - y0) * (rowBytes + 1)], scratch.data());
+            }
+            Chunk &ch = out[c];
+            ch.bytes = filtered.size();
+            ch.adler = adler32_update(1, filtered.data(), filtered.size());
+            ch.idat = {0, 0, 0, 0, 'I', 'D', 'A', 'T'};
+            if (header && c == 0)
+                ch.idat.insert(ch.idat.end(), {0x78, 0x9C}); // zlib: deflate, 32K window
+            ChunkDeflater().compress(filtered.data(), filtered.size(), ch.idat);
+            finish_chunk(ch.idat); });
+
+        bool ok = true;
+        for (const Chunk &ch : out)
+        {
+            ok = ok && std::fwrite(ch.idat.data(), 1, ch.idat.size(), f) == ch.idat.size();
+            adler = adler32_combine(adler, ch.adler, ch.bytes);
+            written += ch.idat.size();
+        }
+        if (rows > 0)
+        {
+            std::vector<uint8_t> last;
+            const uint8_t *p = rgb_row(img, rows - 1, last);
+            above.assign(p, p + rowBytes);
+        }
+        rowsWritten += rows;
+        return ok;
+    }
+
+    bool finish()
+    {
+        // a final empty fixed-Huffman block, then the Adler-32
+        uint8_t tail[6] = {0x03, 0x00};
+        put32(tail + 2, adler);
+        bool ok = rowsWritten == h && write_chunk("IDAT", tail, sizeof(tail)) && write_chunk("IEND", nullptr, 0);
+        ok = (std::fclose(f) == 0) && ok;
+        f = nullptr;
+        return ok;
+    }
+
+    uint64_t bytes_written() const { return written; }
+
+private:
+    static void put32(uint8_t *p, uint32_t v)
+    {
+        p[0] = uint8_t(v >> 24);
+        p[1] = uint8_t(v >> 16);
+        p[2] = uint8_t(v >> 8);
+        p[3] = uint8_t(v);
+    }
+
+    // Fills in the length and CRC of a chunk built as length, type, data.
+    static void finish_chunk(std::vector<uint8_t> &c)
+    {
+        put32(c.data(), uint32_t(c.size() - 8));
+        const uint32_t crc = crc32_update(0, c.data() + 4, c.size() - 4);
+        c.insert(c.end(), 4, 0);
+        put32(&c[c.size() - 4], crc);
+    }
+
+    bool write_chunk(const char *type, const uint8_t *data, size_t n)
+    {
+        std::vector<uint8_t> c = {0, 0, 0, 0, uint8_t(type[0]), uint8_t(type[1]), uint8_t(type[2]), uint8_t(type[3])};
+        if (n)
+            c.insert(c.end(), data, data + n);
+        finish_chunk(c);
+        written += c.size();
+        return std::fwrite(c.data(), 1, c.size(), f) == c.size();
+    }
+
+    // Row y of img as RGB: the row itself, or converted into buf.
+    static const uint8_t *rgb_row(const ImageRGB &img, int y, std::vector<uint8_t> &buf)
+    {
+        const uint8_t *p = img.row_ptr(y);
+        if (img.red_offset() == 0)
+            return p;
+        buf.resize(size_t(img.w) * 3);
+        for (size_t i = 0; i < buf.size(); i += 3)
+        {
+            buf[i] = p[i + 2];
+            buf[i + 1] = p[i + 1];
+            buf[i + 2] = p[i];
+        }
+        return buf.data();
+    }
+
+    FILE *f = nullptr;
+    int w = 0, h = 0, rowsWritten = 0;
+    std::vector<uint8_t> above; // last row of the previous call, RGB
+    uint32_t adler = 1;
+    uint64_t written = 0;
+};
+
+static bool is_png_path(const std::string &path)
+{
+    return path.size() > 4 && path.substr(path.size() - 4) == ".png";
+}
+
+// PNG for a .png name, BMP otherwise.
+static bool save_image(const ImageRGB &img, const std::string &path, int threads)
+{
+    if (!is_png_path(path))
+        return img.save_bmp(path);
+    PngWriter png;
+    return png.open(path, img.w, img.h) && png.write_rows(img, img.h, threads) && png.finish();
+}
+
+// --------------------------- Write Pipeline ---------------------------
+// Recycles depth + 1 image buffers between the rendering thread and one
+// writer thread: the renderer acquires a free buffer, fills it and submits
+// it; the writer passes buffers to the sink in submission order and hands
+// them back. Up to `depth` finished images wait for the sink, so writing or
+// encoding one overlaps rendering of the next.
+class WritePipeline
+{
+public:
+    using Sink = std::function<bool(const ImageRGB &, int index)>;
+
+    WritePipeline(int w, int h, int depth, bool bmpNative, Sink s) : sink(std::move(s))
+    {
+        for (int i = 0; i <= std::max(1, depth); ++i)
+        {
+            buffers.push_back(std::make_unique<ImageRGB>(w, h, bmpNative));
+            freeList.push_back(buffers.back().get());
+        }
+        writer = std::thread([this]
+                             { drain(); });
+    }
+
+    ~WritePipeline() { finish(); }
+
+    // Blocks until a buffer is free; nullptr once the sink has failed.
+    ImageRGB *acquire()
+    {
+        std::unique_lock<std::mutex> lk(m);
+        cv.wait(lk, [&]
+                { return !freeList.empty() || failed; });
+        if (failed)
+            return nullptr;
+        ImageRGB *img = freeList.back();
+        freeList.pop_back();
+        return img;
+    }
+
+    void submit(ImageRGB *img)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            ready.push_back(img);
+        }
+        cv.notify_all();
+    }
+
+    // Waits for every submitted image; false if any sink call failed.
+    bool finish()
+    {
+        if (writer.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                closed = true;
+            }
+            cv.notify_all();
+            writer.join();
+        }
+        return !failed;
+    }
+
+private:
+    void drain()
+    {
+        for (int index = 0;; ++index)
+        {
+            ImageRGB *img;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                cv.wait(lk, [&]
+                        { return !ready.empty() || closed; });
+                if (ready.empty())
+                    return;
+                img = ready.front();
+                ready.pop_front();
+            }
+            bool ok = failed || sink(*img, index);
+            {
+                std::lock_guard<std::mutex> lk(m);
+                failed = !ok;
+                freeList.push_back(img);
+            }
+            cv.notify_all();
+        }
+    }
+
+    Sink sink;
+    std::vector<std::unique_ptr<ImageRGB>> buffers;
+    std::vector<ImageRGB *> freeList;
+    std::deque<ImageRGB *> ready;
+    std::mutex m;
+    std::condition_variable cv;
+    bool closed = false, failed = false;
+    std::thread writer;
+};
+
+// --------------------------- Out-of-Core Rendering ---------------------------
+// Renders the frame in horizontal bands and hands each finished band to a
+// writer thread that appends it to a BigTIFF as one strip, or deflates it
+// into a PNG. At most `inflight` finished bands wait for the writer, so
+// memory stays at a few bands however large the frame is, and encoding and
+// disk I/O overlap rendering of the next band.
+
+// Renders opt's frame top to bottom in bands of `band` rows and passes
+// band b to sink(img, b) on the pipeline's writer thread. False if the
+// sink failed.
+static bool render_bands(const Options &opt, int band, int inflight, const WritePipeline::Sink &sink, uint64_t &iterations)
+{
+    const int W = opt.p.width, H = opt.p.height;
+    const int nBands = (H + band - 1) / band;
+    ColorMap cmap = make_colormap(opt, opt.palette);
+    const Backend backend = resolve_backend(opt.backend);
+
+    FractalParams bp = opt.p;
+    bp.frameWidth = W;
+    bp.frameHeight = H;
+    std::unique_ptr<CPURenderer> r;
+    WritePipeline pipe(W, band, inflight, false, sink);
+    for (int b = 0; b < nBands; ++b)
+    {
+        ImageRGB *img = pipe.acquire();
+        if (!img)
+            break;
+        bp.originY = b * band;
+        if (!r || bp.height != std::min(band, H - bp.originY))
+        {
+            // the last band may be shorter; every other band keeps the renderer
+            r.reset();
+            bp.height = std::min(band, H - bp.originY);
+            r = std::make_unique<CPURenderer>(bp, cmap);
+            configure_renderer(*r, opt);
+        }
+        else
+            r->move_window();
+        render_with(*r, *img, backend, opt.mode, opt.threads);
+        iterations += r->iterations.load();
+        pipe.submit(img);
+    }
+    return pipe.finish();
+}
+
+static int run_out_of_core(const Options &opt)
+{
+    const int W = opt.p.width, H = opt.p.height;
+    const int band = std::clamp(opt.bandRows, 1, H);
+    const int nBands = (H + band - 1) / band;
+    const int inflight = std::max(1, opt.inflight);
+    const std::string &path = opt.out;
+    const bool png = is_png_path(path);
+    if (!png && !path.ends_with(".tif") && !path.ends_with(".tiff"))
+        std::cerr << "[warn] out-of-core output is BigTIFF unless named .png; consider a .tif name for " << path << "\n";
+
+    BigTiffWriter out;
+    PngWriter pngOut;
+    if (!(png ? pngOut.open(path, W, H) : out.open(path, W, H, band)))
+    {
+        std::cerr << "Failed to open output: " << path << "\n";
+        return 1;
+    }
+
+    Timer t;
+    t.start();
+    uint64_t iterations = 0;
+    bool ok = render_bands(opt, band, inflight, [&](const ImageRGB &img, int b)
+                           {
+        const int rows = std::min(band, H - b * band);
+        return png ? pngOut.write_rows(img, rows, opt.threads) : out.write_strip(img.data.data(), size_t(rows) * W * 3u); }, iterations);
+    ok = ok && (png ? pngOut.finish() : out.finish());
+    double ms = t.stop_ms();
+    if (!ok)
+    {
+        std::cerr << "Failed to write " << (png ? "PNG: " : "BigTIFF: ") << path << "\n";
+        return 1;
+    }
+
+    std::cout << "Resolution: " << W << "x" << H << " (out-of-core)\n";
+    std::cout << "Bands:     " << nBands << " x " << band << " rows, " << inflight << " in flight\n";
+    std::cout << "Memory:    " << (double(inflight + 1) * W * band * 3 + double(W) * band * 4) / (1 << 20)
+              << " MB of band buffers\n";
+    std::cout << "Iterations: " << iterations << "\n";
+    std::cout << "Output:    " << path << " ("
+              << double(png ? pngOut.bytes_written() : out.bytes_written()) / (1 << 20) << " MB "
+              << (png ? "PNG" : "BigTIFF") << ")\n";
+    std::cout << "Time:      " << ms << " ms\n";
+    return 0;
+}
+
+// --------------------------- Tile Pyramid ---------------------------
+// `--pyramid <name>` publishes a zoomable image in Deep Zoom layout:
+// <name>.dzi plus <name>_files/<level>/<col>_<row>.png, level 0 being one
+// pixel and the last level the full frame. Only the last level is
+// rendered; each coarser one is a 2x2 box filter of the level below, made
+// as its rows stream in, so the pyramid costs one render plus filtering
+// and encoding a third more pixels.
+
+// One row of the next level from rows a and b of w RGB pixels (b == a for
+// an odd last row); an odd last column averages with itself. The vertical
+// sum is a plain pass over bytes so it vectorizes.
+static void box_filter_row(const uint8_t *a, const uint8_t *b, int w, uint8_t *out, uint16_t *sum)
+{
+    const size_t n = size_t(w) * 3;
+    for (size_t i = 0; i < n; ++i)
+        sum[i] = uint16_t(a[i] + b[i]);
+    const int half = w / 2;
+    for (int x = 0; x < half; ++x)
+    {
+        const uint16_t *s = sum + size_t(x) * 6;
+        uint8_t *o = out + size_t(x) * 3;
+        o[0] = uint8_t((s[0] + s[3] + 2) >> 2);
+        o[1] = uint8_t((s[1] + s[4] + 2) >> 2);
+        o[2] = uint8_t((s[2] + s[5] + 2) >> 2);
+    }
+    if (w & 1)
+        for (int c = 0; c < 3; ++c)
+            out[size_t(half) * 3 + c] = uint8_t((sum[size_t(w - 1) * 3 + c] + 1) >> 1);
+}
+
+// Takes the full-resolution rows top to bottom, in blocks of any height.
+// Every level keeps one row of tiles and at most one row waiting for its
+// pair, so memory is about two tile rows of the full width.
+class TilePyramid
+{
+public:
+    bool open(const std::string &name, int width, int height, int tile, int nthreads)
+    {
+        base = name;
+        tileSize = tile;
+        threads = nthreads;
+        levels.clear();
+        for (int w = width, h = height;; w = (w + 1) / 2, h = (h + 1) / 2)
+        {
+            levels.insert(levels.begin(), Level(w, h, tile));
+            if (w == 1 && h == 1)
+                break;
+        }
+        std::error_code ec;
+        for (size_t l = 0; l < levels.size(); ++l)
+            if (!std::filesystem::create_directories(level_dir(int(l)), ec) && ec)
+                return false;
+        return true;
+    }
+
+    // The next `rows` rows of the full level; row k at rows + k * stride.
+    bool add_rows(const uint8_t *rows, size_t stride, int n) { return push(int(levels.size()) - 1, rows, stride, n); }
+
+    // Writes <name>.dzi once every level is complete.
+    bool finish()
+    {
+        for (const Level &lv : levels)
+            if (lv.received != lv.h)
+                return false;
+        const Level &full = levels.back();
+        std::ofstream dzi(base + ".dzi");
+        dzi << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"0\" TileSize=\""
+            << tileSize << "\">\n  <Size Width=\"" << full.w << "\" Height=\"" << full.h << "\"/>\n</Image>\n";
+        return bool(dzi);
+    }
+
+    int level_count() const { return int(levels.size()); }
+    uint64_t tiles = 0, bytes = 0, pixels = 0; // written
+    double filterMs = 0, encodeMs = 0;
+
+private:
+    struct Level
+    {
+        Level(int width, int height, int tile) : w(width), h(height), buf(width, std::min(height, tile)) {}
+
+        int w, h;
+        ImageRGB buf; // the current row of tiles
+        int bufRows = 0, received = 0, tileRow = 0;
+        std::vector<uint8_t> carry; // an even row still waiting for its pair
+        bool hasCarry = false;
+    };
+
+    std::string level_dir(int l) const { return base + "_files/" + std::to_string(l); }
+
+    bool push(int l, const uint8_t *rows, size_t stride, int n)
+    {
+        if (n == 0)
+            return true;
+        Level &lv = levels[l];
+        const size_t rowBytes = size_t(lv.w) * 3;
+        for (int i = 0; i < n;)
+        {
+            const int take = std::min(n - i, lv.buf.h - lv.bufRows);
+            for (int k = 0; k < take; ++k)
+                std::memcpy(lv.buf.row_ptr(lv.bufRows + k), rows + size_t(i + k) * stride, rowBytes);
+            lv.bufRows += take;
+            lv.received += take;
+            i += take;
+            if ((lv.bufRows == lv.buf.h || lv.received == lv.h) && !write_tile_row(l))
+                return false;
+        }
+        if (l == 0)
+            return true;
+
+        // pairs of rows, the first one possibly carried from the last block
+        Timer t;
+        t.start();
+        const Level &up = levels[l - 1];
+        const bool last = lv.received == lv.h;
+        const int total = n + (lv.hasCarry ? 1 : 0);
+        const int outRows = last ? (total + 1) / 2 : total / 2;
+        const size_t upBytes = size_t(up.w) * 3;
+        auto row_at = [&](int k)
+        {
+            if (lv.hasCarry)
+                return k == 0 ? lv.carry.data() : rows + size_t(k - 1) * stride;
+            return rows + size_t(k) * stride;
+        };
+        std::vector<uint8_t> down(size_t(outRows) * upBytes);
+        constexpr int Block = 16; // output rows per task, sharing one sum row
+        CPURenderer::parallel_for((outRows + Block - 1) / Block, threads, 1, [&](int blk)
+                                  {
+            std::vector<uint16_t> sum(rowBytes);
+            for (int r = blk * Block; r < std::min(outRows, (blk + 1) * Block); ++r)
+            {
+                const uint8_t *a = row_at(2 * r);
+                box_filter_row(a, 2 * r + 1 < total ? row_at(2 * r + 1) : a, lv.w, &down[size_t(r) * upBytes], sum.data());
+            } });
+        if (!last && total % 2)
+        {
+            const uint8_t *odd = row_at(total - 1);
+            if (odd != lv.carry.data())
+                lv.carry.assign(odd, odd + rowBytes);
+        }
+        lv.hasCarry = !last && total % 2;
+        filterMs += t.stop_ms();
+        return push(l - 1, down.data(), upBytes, outRows);
+    }
+
+    // Encodes the buffered row of tiles of level l, one tile per task.
+    bool write_tile_row(int l)
+    {
+        Timer t;
+        t.start();
+        Level &lv = levels[l];
+        const int cols = (lv.w + tileSize - 1) / tileSize;
+        std::atomic<bool> ok{true};
+        std::atomic<uint64_t> written{0};
+        CPURenderer::parallel_for(cols, threads, 1, [&](int c)
+                                  {
+            const int x0 = c * tileSize, tw = std::min(tileSize, lv.w - x0);
+            ImageRGB tile(tw, lv.bufRows);
+            for (int y = 0; y < lv.bufRows; ++y)
+                std::memcpy(tile.row_ptr(y), lv.buf.row_ptr(y) + size_t(x0) * 3, size_t(tw) * 3);
+            PngWriter png;
+            const std::string path = level_dir(l) + "/" + std::to_string(c) + "_" + std::to_string(lv.tileRow) + ".png";
+            if (png.open(path, tw, lv.bufRows) && png.write_rows(tile, lv.bufRows, 1) && png.finish())
+                written += png.bytes_written();
+            else
+                ok = false; });
+        tiles += cols;
+        bytes += written.load();
+        pixels += uint64_t(lv.w) * lv.bufRows;
+        lv.bufRows = 0;
+        ++lv.tileRow;
+        encodeMs += t.stop_ms();
+        return ok.load();
+    }
+
+    std::string base;
+    int tileSize = 256, threads = 1;
+    std::vector<Level> levels; // index = Deep Zoom level, back() = full frame
+};
+
+// Renders the full level once, whole or (--out-of-core) band by band with
+// the pyramid built on the writer thread, and writes every level as tiles.
+static int run_pyramid(const Options &opt)
+{
+    const int W = opt.p.width, H = opt.p.height;
+    const int tile = std::max(16, opt.tileSize);
+    TilePyramid pyr;
+    if (!pyr.open(opt.pyramid, W, H, tile, opt.threads))
+    {
+        std::cerr << "Failed to create " << opt.pyramid << "_files/\n";
+        return 1;
+    }
+
+    Timer t;
+    t.start();
+    uint64_t iterations = 0;
+    double renderMs = 0;
+    bool ok;
+    if (opt.outOfCore)
+    {
+        const int band = std::clamp(opt.bandRows, 1, H);
+        ok = render_bands(opt, band, std::max(1, opt.inflight), [&](const ImageRGB &img, int b)
+                          { return pyr.add_rows(img.row_ptr(0), img.stride, std::min(band, H - b * band)); }, iterations);
+    }
+    else
+    {
+        ImageRGB img(W, H);
+        ColorMap cmap = make_colormap(opt, opt.palette);
+        CPURenderer r(opt.p, cmap);
+        configure_renderer(r, opt);
+        render_with(r, img, resolve_backend(opt.backend), opt.mode, opt.threads);
+        iterations = r.iterations.load();
+        renderMs = t.stop_ms();
+        ok = pyr.add_rows(img.row_ptr(0), img.stride, H);
+    }
+    ok = ok && pyr.finish();
+    const double ms = t.stop_ms();
+    if (!ok)
+    {
+        std::cerr << "Failed to write pyramid: " << opt.pyramid << "\n";
+        return 1;
+    }
+
+    std::cout << "Resolution: " << W << "x" << H << " (pyramid" << (opt.outOfCore ? ", out-of-core" : "") << ")\n";
+    std::cout << "Levels:    " << pyr.level_count() << " of " << tile << "px tiles, " << pyr.tiles << " tiles ("
+              << double(pyr.bytes) / (1 << 20) << " MB PNG)\n";
+    std::cout << "Pixels:    " << double(pyr.pixels) / (double(W) * H) << "x the full level\n";
+    std::cout << "Iterations: " << iterations << "\n";
+    if (!opt.outOfCore)
+        std::cout << "Render:    " << renderMs << " ms\n";
+    std::cout << "Filter:    " << pyr.filterMs << " ms, encode " << pyr.encodeMs << " ms\n";
+    std::cout << "Output:    " << opt.pyramid << ".dzi, " << opt.pyramid << "_files/\n";
+    std::cout << "Time:      " << ms << " ms\n";
+    return 0;
+}
+
+// --------------------------- Zoom Animation ---------------------------
+// Renders a keyframe path in one process: one renderer (thread pool, field)
+// and a ring of frame buffers are reused for every frame, and frame k is
+// encoded on the pipeline's writer thread while frame k + 1 renders.
+struct Keyframe
+{
+    std::string cx, cy; // kept as text for deep-zoom precision
+    double scale;
+    int maxIter;
+    PaletteType palette;
+};
+
+// One keyframe per line: <cx> <cy> <scale> [maxiter] [palette]; '#' comments.
+static bool load_keyframes(const std::string &path, const Options &opt, std::vector<Keyframe> &out)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ls(line);
+        Keyframe k{"", "", 0.0, opt.p.maxIter, opt.palette};
+        std::string pal;
+        int iters;
+        if (!(ls >> k.cx >> k.cy >> k.scale) || !(k.scale > 0.0))
+            continue;
+        if (ls >> iters)
+            k.maxIter = iters;
+        if (ls >> pal)
+            k.palette = parse_palette(pal);
+        out.push_back(k);
+    }
+    return !out.empty();
+}
+
+// Coordinate at fraction w from a to b (wb = 1 - w, computed without the
+// cancellation), in BigFixed: the offset is taken from the nearer keyframe,
+// so its double rounding shrinks with the frame's distance to it. Empty if
+// a coordinate does not parse.
+static std::string interpolate_coordinate(const std::string &a, const std::string &b, double w, double wb, int limbs)
+{
+    BigFixed va, vb, diff(limbs), off(limbs), out(limbs);
+    if (!BigFixed::from_string(a, limbs, va) || !BigFixed::from_string(b, limbs, vb))
+        return "";
+    BigFixed::sub(vb, va, diff);
+    std::vector<uint32_t> scratch;
+    BigFixed::mul(diff, BigFixed::from_double(std::min(w, wb), limbs), off, scratch);
+    if (wb < w)
+        BigFixed::sub(vb, off, out);
+    else
+        BigFixed::add(va, off, out);
+    return out.to_string(int(std::ceil(32 * (limbs - 1) * 0.30103)) + 1);
+}
+
+// View at u in [0, 1] along the path, keyframes equally spaced. The scale is
+// interpolated geometrically and the centre moves in proportion to the scale
+// change, so a zoom between two keyframes converges on the second centre at a
+// constant on-screen speed. The centre is carried as text at the precision
+// the deeper keyframe needs, so deep-zoom frames between keyframes keep it.
+// Returns the last keyframe reached, whose palette the frame uses.
+static int keyframe_view(const std::vector<Keyframe> &keys, double u, FractalParams &p)
+{
+    const int last = int(keys.size()) - 1;
+    const double pos = u * last;
+    const int seg = std::min(int(pos), std::max(0, last - 1));
+    const Keyframe &a = keys[seg], &b = keys[std::min(seg + 1, last)];
+    const double t = last > 0 ? pos - seg : 0.0;
+
+    const double ax = std::strtod(a.cx.c_str(), nullptr), ay = std::strtod(a.cy.c_str(), nullptr);
+    const double bx = std::strtod(b.cx.c_str(), nullptr), by = std::strtod(b.cy.c_str(), nullptr);
+    p.scale = a.scale * std::pow(b.scale / a.scale, t);
+    const bool zooms = std::abs(a.scale - b.scale) > 1e-12 * a.scale;
+    const double w = zooms ? (a.scale - p.scale) / (a.scale - b.scale) : t;
+    const double wb = zooms ? (p.scale - b.scale) / (a.scale - b.scale) : 1.0 - t;
+    p.centerX = ax + (bx - ax) * w;
+    p.centerY = ay + (by - ay) * w;
+    p.maxIter = int(std::lround(a.maxIter + (b.maxIter - a.maxIter) * t));
+
+    // a keyframe's own text where the centre is its own
+    const bool atA = w == 0.0 || (a.cx == b.cx && a.cy == b.cy);
+    const Keyframe *exact = atA ? &a : wb == 0.0 ? &b : nullptr;
+    if (exact)
+    {
+        p.centerXStr = exact->cx;
+        p.centerYStr = exact->cy;
+        return std::min(int(pos), last);
+    }
+    // as many fraction bits as PerturbationEngine takes at the deeper end
+    const double spacing = 2.0 * std::min(a.scale, b.scale) / std::max(1, p.full_width() - 1);
+    const int limbs = (std::max(64, (int)std::ceil(-std::log2(spacing)) + 64) + 31) / 32 + 1;
+    p.centerXStr = interpolate_coordinate(a.cx, b.cx, w, wb, limbs);
+    p.centerYStr = interpolate_coordinate(a.cy, b.cy, w, wb, limbs);
+    if (p.centerXStr.empty() || p.centerYStr.empty())
+        p.centerXStr.clear(), p.centerYStr.clear();
+    return std::min(int(pos), last);
+}
+
+static int run_animation(const Options &opt)
+{
+    std::vector<Keyframe> keys;
+    if (!load_keyframes(opt.animate, opt, keys))
+    {
+        std::cerr << "Failed to read keyframes: " << opt.animate << "\n";
+        return 1;
+    }
+    const int W = opt.p.width, H = opt.p.height;
+    const int frames = std::max(1, opt.frames);
+    const std::string &path = opt.out;
+    const bool toPipe = path == "-";
+    const bool isGif = path.size() > 4 && path.substr(path.size() - 4) == ".gif";
+    const bool isSeq = !toPipe && !isGif && path.find('%') != std::string::npos;
+    if (!toPipe && !isGif && !isSeq)
+    {
+        std::cerr << "Animation output must be a .gif, a frame pattern like frame_%04d.bmp, or - for raw RGB\n";
+        return 1;
+    }
+    std::ostream &log = toPipe ? std::cerr : std::cout; // stdout carries the frames
+
+    GifWriter gif;
+    if (isGif && !gif.open(path, W, H, std::max(1, int(std::lround(100.0 / std::max(1, opt.fps))))))
+    {
+        std::cerr << "Failed to open output: " << path << "\n";
+        return 1;
+    }
+
+    std::vector<ColorMap> maps; // compiled once per keyframe
+    for (const Keyframe &k : keys)
+        maps.push_back(make_colormap(opt, k.palette));
+    const Backend backend = resolve_backend(opt.backend);
+
+    FractalParams view = opt.p;
+    ColorMap frameMap = maps.front();
+    int frameKey = 0;
+    CPURenderer renderer(view, frameMap);
+    configure_renderer(renderer, opt);
+
+    double encodeMs = 0.0; // writer thread only; read after finish()
+    WritePipeline pipe(W, H, opt.inflight, opt.bmpNative && isSeq, [&](const ImageRGB &img, int k)
+                       {
+        Timer te;
+        te.start();
+        bool ok = true;
+        if (isGif)
+            ok = gif.add_frame(img);
+        else if (isSeq)
+        {
+            std::vector<char> name(path.size() + 32);
+            std::snprintf(name.data(), name.size(), path.c_str(), k);
+            ok = save_image(img, name.data(), opt.threads);
+        }
+        else
+            ok = std::fwrite(img.data.data(), 1, img.data.size(), stdout) == img.data.size();
+        encodeMs += te.stop_ms();
+        return ok; });
+
+    Timer t, tr;
+    t.start();
+    double renderMs = 0.0;
+    uint64_t iterations = 0;
+    for (int k = 0; k < frames; ++k)
+    {
+        ImageRGB *img = pipe.acquire();
+        if (!img)
+            break;
+        int key = keyframe_view(keys, frames > 1 ? double(k) / (frames - 1) : 0.0, view);
+        if (key != frameKey)
+        {
+            frameMap = maps[key];
+            frameKey = key;
+        }
+        renderer.retarget();
+        tr.start();
+        render_with(renderer, *img, backend, opt.mode, opt.threads);
+        renderMs += tr.stop_ms();
+        iterations += renderer.iterations.load();
+        pipe.submit(img);
+    }
+    bool ok = pipe.finish();
+    if (toPipe)
+        ok = std::fflush(stdout) == 0 && ok;
+    if (isGif)
+        ok = gif.finish() && ok;
+    double ms = t.stop_ms();
+    if (!ok)
+    {
+        std::cerr << "Failed to write animation: " << path << "\n";
+        return 1;
+    }
+
+    log << "Resolution: " << W << "x" << H << "\n";
+    log << "Frames:    " << frames << " from " << keys.size() << " keyframe(s)\n";
+    log << "Iterations: " << iterations << "\n";
+    log << "Output:    " << path << "\n\n";
+    log << "Total time:  " << ms << " ms (" << ms / frames << " ms/frame)\n";
+    log << "Rendering:   " << renderMs << " ms\n";
+    log << "Encoding:    " << encodeMs << " ms (overlapped with rendering)\n";
+    return 0;
+}
+
+// --------------------------- Benchmark ---------------------------
+// `mandelbrot bench`: every scene x backend x thread count is rendered
+// `warmup` times untimed, then `reps` times timed. Reported figures are the
+// median and nearest-rank p95 wall time of the timed renders, with throughput
+// derived from the median.
+struct BenchScene
+{
+    const char *name;
+    FractalType type;
+    double cx, cy, scale;
+    int maxIter;
+};
+
+static const BenchScene BenchScenes[] = {
+    {"full", FractalType::Mandelbrot, -0.75, 0.0, 1.5, 1000},
+    {"seahorse", FractalType::Mandelbrot, -0.743643887037158, 0.131825904205312, 0.005, 2000},
+    {"interior", FractalType::Mandelbrot, -0.1226, 0.7449, 0.02, 10000}, // mostly inside the period-3 bulb
+    {"julia", FractalType::Julia, 0.0, 0.0, 1.5, 1000},
+};
+
+struct BenchResult
+{
+    std::string scene, backend;
+    int threads;
+    double medianMs, p95Ms, minMs;
+    uint64_t iterations; // per render
+    double mpixPerS, gitersPerS;
+};
+
+static int run_bench(const Options &opt)
+{
+    std::vector<const BenchScene *> scenes;
+    for (const BenchScene &sc : BenchScenes)
+        if (opt.scenes.empty() || std::find(opt.scenes.begin(), opt.scenes.end(), sc.name) != opt.scenes.end())
+            scenes.push_back(&sc);
+    if (scenes.empty())
+    {
+        std::cerr << "No known scene in --scenes (full, seahorse, interior, julia)\n";
+        return 1;
+    }
+    const std::vector<std::string> backends = opt.backends.empty() ? std::vector<std::string>{"serial", "auto"} : opt.backends;
+    const std::vector<int> threadList = opt.threadList.empty() ? std::vector<int>{opt.threads} : opt.threadList;
+    const int reps = std::max(1, opt.reps), warmup = std::max(0, opt.warmup);
+    const double pixels = double(opt.p.width) * opt.p.height;
+    std::ostream &log = opt.json == "-" ? std::cerr : std::cout;
+
+    ColorMap cmap = make_colormap(opt, opt.palette);
+    ImageRGB img(opt.p.width, opt.p.height, opt.bmpNative, opt.numa);
+    std::vector<BenchResult> results;
+
+    log << "Resolution: " << opt.p.width << "x" << opt.p.height << ", " << warmup << " warmup + " << reps
+        << " timed render(s) per case\n\n";
+    log << "scene     backend                 threads   median ms    p95 ms   Mpix/s   Giter/s\n";
+    for (const BenchScene *sc : scenes)
+    {
+        FractalParams p = opt.p;
+        p.type = sc->type;
+        p.centerX = sc->cx;
+        p.centerY = sc->cy;
+        p.centerXStr.clear();
+        p.centerYStr.clear();
+        p.scale = sc->scale;
+        p.maxIter = sc->maxIter;
+
+        for (const std::string &bname : backends)
+        {
+            Options o = opt;
+            o.backend = parse_backend(bname, o.simd);
+            const Backend backend = resolve_backend(o.backend);
+            CPURenderer renderer(p, cmap);
+            configure_renderer(renderer, o);
+            for (int threads : threadList)
+            {
+                if (backend == Backend::Serial && threads != threadList.front())
+                    continue; // thread count does not apply
+                const int n = backend == Backend::Serial ? 1 : threads;
+                for (int i = 0; i < warmup; ++i)
+                    render_with(renderer, img, backend, o.mode, n);
+                std::vector<double> ms;
+                Timer t;
+                for (int i = 0; i < reps; ++i)
+                {
+                    t.start();
+                    render_with(renderer, img, backend, o.mode, n);
+                    ms.push_back(t.stop_ms());
+                }
+                std::sort(ms.begin(), ms.end());
+                const double median = reps % 2 ? ms[reps / 2] : 0.5 * (ms[reps / 2 - 1] + ms[reps / 2]);
+                const double p95 = ms[size_t(std::ceil(0.95 * reps)) - 1];
+                const uint64_t iters = renderer.iterations.load();
+
+                BenchResult r{sc->name, std::string(backend_name(backend)) + (renderer.simd != SimdLevel::Scalar ? std::string("+") + simd_name(renderer.simd) : "") + (o.numa ? "+numa" : ""),
+                              n, median, p95, ms.front(), iters, pixels / (median * 1e3), double(iters) / (median * 1e6)};
+                char line[160];
+                std::snprintf(line, sizeof(line), "%-9s %-23s %7d %11.2f %9.2f %8.2f %9.3f\n", r.scene.c_str(),
+                              r.backend.c_str(), r.threads, r.medianMs, r.p95Ms, r.mpixPerS, r.gitersPerS);
+                log << line;
+                results.push_back(r);
+            }
+        }
+    }
+
+    if (opt.json.empty())
+        return 0;
+    std::ofstream file;
+    if (opt.json != "-")
+    {
+        file.open(opt.json);
+        if (!file)
+        {
+            std::cerr << "Failed to open JSON output: " << opt.json << "\n";
+            return 1;
+        }
+    }
+    std::ostream &js = opt.json == "-" ? std::cout : file;
+    js << "{\n  \"width\": " << opt.p.width << ",\n  \"height\": " << opt.p.height << ",\n  \"warmup\": " << warmup
+       << ",\n  \"reps\": " << reps << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+       << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult &r = results[i];
+        js << (i ? "," : "") << "\n    {\"scene\": \"" << r.scene << "\", \"backend\": \"" << r.backend
+           << "\", \"threads\": " << r.threads << ", \"median_ms\": " << r.medianMs << ", \"p95_ms\": " << r.p95Ms
+           << ", \"min_ms\": " << r.minMs << ", \"iterations\": " << r.iterations << ", \"mpixels_per_s\": "
+           << r.mpixPerS << ", \"giterations_per_s\": " << r.gitersPerS << "}";
+    }
+    js << "\n  ]\n}\n";
+    return js.good() ? 0 : 1;
+}
+
+// --------------------------- Render Cache ---------------------------
+// --cache-dir keeps finished iteration fields on disk, addressed by a hash of
+// everything that determines the field. The palette is not part of the key,
+// since colouring a cached field takes milliseconds. An entry is a fixed
+// header and the key text, then raw arrays at 64-byte-aligned offsets, so it
+// reads with plain freads or maps straight into memory. Entries are written
+// under a temporary name and renamed into place, so processes sharing the
+// directory never see a partial file. A hit refreshes the entry's mtime, and
+// the least recently used entries are evicted past --cache-max-mb.
+struct FieldCacheHeader
 {
-    std::cout <<
-        R"(Usage: mandelbrot [options]
-  --w <int>               image width (default 1920)
-  --h <int>               image height (default 1080)
-  --maxiter <int>         max iterations (default 1000)
-  --cx <float>            center X (default -0.75)
-  --cy <float>            center Y (default 0.0)
-  --scale <float>         half-width in complex plane (default 1.5)
-  --type <mandelbrot|julia> (default mandelbrot)
-  --jre <float>           Julia c real (default -0.8)
-  --jim <float>           Julia c imag (default 0.156)
-  --threads <int>         CPU threads (default HW concurrency)
-  --backend <auto|omp|threads|serial> (default auto)
-   --palette <smooth|original|fire|bw|gradient|banded>
-  --colors  <#RRGGBB,#RRGGBB,...>  (for gradient/banded)
-  --widths  <w1,w2,...>            (for banded; default all 12)
-  --feather <0..1>                 (banded softness, default 1)
-  --hue <float>  --sat <float>  --val <float>  (global HSV tweaks)
-  --out <filename.bmp>    output BMP file (default fractal.bmp)
-)";
+    char magic[8]; // "MOMFLD02", bumped whenever the layout or field contents change
+    uint32_t keyBytes;
+    int32_t width, height, maxIter, aaCount;
+    uint64_t aaPixels;
+    uint64_t fieldOffset, aaPixelOffset, aaSampleOffset, fileBytes;
+};
+static constexpr char FieldCacheMagic[8] = {'M', 'O', 'M', 'F', 'L', 'D', '0', '2'};
+static constexpr int32_t FieldCacheMaxAA = 1024; // samples per pixel a header may claim
+
+// Every input of the field, with doubles as exact hex floats. A completed
+// progressive render equals a full one, so both share entries.
+static std::string field_cache_key(const CPURenderer &r, RenderMode mode)
+{
+    const FractalParams &p = r.params;
+    std::ostringstream k;
+    k << std::hexfloat << "field " << p.width << "x" << p.height << " frame " << p.full_width() << "x"
+      << p.full_height() << "+" << p.originX << "+" << p.originY << " type " << int(p.type) << " power " << p.power
+      << " center " << p.centerX << " " << p.centerY << " [" << p.centerXStr << " " << p.centerYStr << "] scale "
+      << p.scale << " julia " << p.juliaRe << " " << p.juliaIm << " maxiter " << p.maxIter << " deep "
+      << (r.deep != nullptr) << " series " << p.series << " interior " << p.interiorChecks << " tier " << int(r.tier)
+      << " simd " << int(r.simd) << " mode " << (mode == RenderMode::Progressive ? "full" : mode_name(mode)) << " aa "
+      << r.aaSamples << " " << r.aaThreshold;
+    return k.str();
+}
+
+static std::string field_cache_path(const std::string &dir, const std::string &key)
+{
+    uint64_t h = 0xcbf29ce484222325ull; // FNV-1a of the format magic, then the key
+    for (unsigned char c : FieldCacheMagic)
+        h = (h ^ c) * 0x100000001b3ull;
+    for (unsigned char c : key)
+        h = (h ^ c) * 0x100000001b3ull;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.field", (unsigned long long)h);
+    return (std::filesystem::path(dir) / name).string();
+}
+
+// Reads an entry of the field's size whose key passes accept(key). Sizes in
+// the header are checked against the field and the file before anything is
+// allocated, so a truncated or corrupt entry is just a miss.
+template <class A>
+static bool read_field_file(const std::string &path, IterField &field, A &&accept)
+{
+    FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    FieldCacheHeader h;
+    std::string stored;
+    const size_t pixels = size_t(field.w) * field.h;
+    bool ok = std::fread(&h, sizeof(h), 1, f) == 1 && std::memcmp(h.magic, FieldCacheMagic, 8) == 0 &&
+              h.keyBytes < (1u << 20) && h.width == field.w && h.height == field.h;
+    if (ok)
+    {
+        stored.resize(h.keyBytes);
+        ok = std::fread(stored.data(), 1, stored.size(), f) == stored.size() && accept(stored) &&
+             std::fseek(f, 0, SEEK_END) == 0 && uint64_t(std::ftell(f)) == h.fileBytes;
+    }
+    ok = ok && h.aaCount >= 0 && h.aaCount <= FieldCacheMaxAA && h.aaPixels <= pixels &&
+         std::max({h.fieldOffset, h.aaPixelOffset, h.aaSampleOffset}) <= h.fileBytes &&
+         h.fieldOffset + pixels * sizeof(float) <= h.fileBytes &&
+         h.aaPixelOffset + h.aaPixels * sizeof(uint64_t) <= h.fileBytes &&
+         h.aaSampleOffset + h.aaPixels * uint64_t(h.aaCount) * sizeof(float) <= h.fileBytes;
+    std::vector<uint64_t> aaPixel;
+    std::vector<float> aaSamples;
+    if (ok)
+    {
+        aaPixel.resize(h.aaPixels);
+        aaSamples.resize(h.aaPixels * std::max(0, h.aaCount));
+        ok = std::fseek(f, long(h.fieldOffset), SEEK_SET) == 0 &&
+             std::fread(field.s.data(), sizeof(float), pixels, f) == pixels &&
+             std::fseek(f, long(h.aaPixelOffset), SEEK_SET) == 0 &&
+             std::fread(aaPixel.data(), sizeof(uint64_t), aaPixel.size(), f) == aaPixel.size() &&
+             std::fseek(f, long(h.aaSampleOffset), SEEK_SET) == 0 &&
+             std::fread(aaSamples.data(), sizeof(float), aaSamples.size(), f) == aaSamples.size();
+        for (size_t i = 0; ok && i < aaPixel.size(); ++i) // ascending pixel indices, as colorize_row expects
+            ok = aaPixel[i] < pixels && (i == 0 || aaPixel[i - 1] < aaPixel[i]);
+    }
+    std::fclose(f);
+    if (!ok)
+        return false;
+    field.maxIter = h.maxIter;
+    field.aaCount = h.aaCount;
+    field.aaPixel.assign(aaPixel.begin(), aaPixel.end());
+    field.aaSamples = std::move(aaSamples);
+    return true;
+}
+
+static bool load_cached_field(const std::string &path, const std::string &key, IterField &field)
+{
+    if (!read_field_file(path, field, [&](const std::string &stored)
+                         { return stored == key; }))
+        return false;
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec); // LRU age
+    return true;
+}
+
+static bool store_cached_field(const std::string &path, const std::string &key, const IterField &field)
+{
+    auto align = [](uint64_t v)
+    { return (v + 63) & ~uint64_t(63); };
+    const size_t pixels = size_t(field.w) * field.h;
+    FieldCacheHeader h{};
+    std::memcpy(h.magic, FieldCacheMagic, 8);
+    h.keyBytes = uint32_t(key.size());
+    h.width = field.w;
+    h.height = field.h;
+    h.maxIter = field.maxIter;
+    h.aaCount = field.aaCount;
+    h.aaPixels = field.aaPixel.size();
+    h.fieldOffset = align(sizeof(h) + key.size());
+    h.aaPixelOffset = align(h.fieldOffset + pixels * sizeof(float));
+    h.aaSampleOffset = align(h.aaPixelOffset + h.aaPixels * sizeof(uint64_t));
+    h.fileBytes = h.aaSampleOffset + field.aaSamples.size() * sizeof(float);
+
+    std::random_device rd;
+    const std::string tmp = path + ".tmp" + std::to_string(rd()) + std::to_string(rd());
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    const std::vector<uint64_t> aaPixel(field.aaPixel.begin(), field.aaPixel.end());
+    const char zeros[64] = {};
+    auto pad_to = [&](uint64_t offset)
+    {
+        const size_t n = size_t(offset - uint64_t(std::ftell(f)));
+        return std::fwrite(zeros, 1, n, f) == n;
+    };
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 && std::fwrite(key.data(), 1, key.size(), f) == key.size();
+    ok = ok && pad_to(h.fieldOffset) && std::fwrite(field.s.data(), sizeof(float), pixels, f) == pixels;
+    ok = ok && pad_to(h.aaPixelOffset) && std::fwrite(aaPixel.data(), sizeof(uint64_t), aaPixel.size(), f) == aaPixel.size();
+    ok = ok && pad_to(h.aaSampleOffset) &&
+         std::fwrite(field.aaSamples.data(), sizeof(float), field.aaSamples.size(), f) == field.aaSamples.size();
+    ok = (std::fclose(f) == 0) && ok;
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(tmp, path, ec); // atomic replace
+    if (!ok || ec)
+        std::filesystem::remove(tmp, ec);
+    return ok && !ec;
+}
+
+// --incremental keeps the last full frame in a file of the same format: its
+// key is the field's view, as exact hex floats, then its family.
+static bool load_field_state(const std::string &path, IterField &field)
+{
+    IterField::View v;
+    std::string family;
+    auto accept = [&](const std::string &key)
+    {
+        const char *c = key.c_str();
+        char *end = nullptr;
+        if (std::strncmp(c, "view ", 5) != 0)
+            return false;
+        c += 5;
+        for (double *d : {&v.re0, &v.im0, &v.stepRe, &v.stepIm})
+        {
+            *d = std::strtod(c, &end);
+            if (end == c)
+                return false;
+            c = end;
+        }
+        if (*c != '\n')
+            return false;
+        family = c + 1;
+        return true;
+    };
+    if (!read_field_file(path, field, accept))
+        return false;
+    field.view = v;
+    field.family = family;
+    return true;
+}
+
+static bool store_field_state(const std::string &path, const IterField &field)
+{
+    std::ostringstream k;
+    k << std::hexfloat << "view " << field.view.re0 << " " << field.view.im0 << " " << field.view.stepRe << " "
+      << field.view.stepIm << "\n"
+      << field.family;
+    return store_cached_field(path, k.str(), field);
+}
+
+// --pan / --zoom: the view of the stored frame v moved by (dx, dy) pixels and
+// zoomed 2x in (zoom > 0) or out, with the centre snapped so the new pixels
+// land on stored ones: a zoom in puts the first pixel on a whole or half
+// stored pixel, a zoom out on a whole one.
+static void step_view(FractalParams &p, const IterField::View &v, int dx, int dy, int zoom)
+{
+    const int W = p.width, H = p.height;
+    double qx = (W - 1) / 2.0 + dx, qy = (H - 1) / 2.0 + dy; // in stored pixels
+    double scale = v.stepRe * (W - 1) / 2.0;
+    auto half_snap = [](double q, int n)
+    { return (std::round(2.0 * q - (n - 1) / 2.0) + (n - 1) / 2.0) / 2.0; };
+    if (zoom > 0)
+    {
+        qx = half_snap(qx, W);
+        qy = half_snap(qy, H);
+        scale /= 2.0;
+    }
+    else if (zoom < 0)
+    {
+        qx = std::round(qx);
+        qy = std::round(qy);
+        scale *= 2.0;
+    }
+    p.centerX = v.re0 + qx * v.stepRe;
+    p.centerY = v.im0 + qy * v.stepIm;
+    p.scale = scale;
+    p.centerXStr.clear();
+    p.centerYStr.clear();
+}
+
+// Removes least recently used entries until the directory holds at most
+// `limit` bytes of them, plus temporaries left by crashed writers.
+static void evict_field_cache(const std::string &dir, uint64_t limit)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    std::vector<std::tuple<fs::file_time_type, uint64_t, fs::path>> entries;
+    uint64_t total = 0;
+    const auto now = fs::file_time_type::clock::now();
+    for (const auto &e : fs::directory_iterator(dir, ec))
+    {
+        const fs::path &path = e.path();
+        const auto mtime = fs::last_write_time(path, ec);
+        if (ec)
+            continue;
+        if (path.string().find(".field.tmp") != std::string::npos)
+        {
+            if (now - mtime > std::chrono::hours(1))
+                fs::remove(path, ec);
+            continue;
+        }
+        if (path.extension() != ".field")
+            continue;
+        const uint64_t size = fs::file_size(path, ec);
+        if (ec)
+            continue;
+        entries.emplace_back(mtime, size, path);
+        total += size;
+    }
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() && total > limit; ++i)
+    {
+        fs::remove(std::get<2>(entries[i]), ec); // another process may have removed it already
+        total -= std::get<1>(entries[i]);
+    }
+}
+
+// --------------------------- Tile Server ---------------------------
+// `mandelbrot serve` answers GET /z/x/y.bmp (XYZ / slippy-map tiles) over
+// HTTP/1.1 with keep-alive, on 127.0.0.1 or a Unix socket. A request is served
+// from the LRU of encoded tiles, joins an identical request that is already
+// rendering, or queues a render on the shared workers (--threads), each of
+// which keeps one renderer and one tile image. GET /stats reports counters
+// and nearest-rank p50/p99 latencies as JSON.
+static constexpr int TileMaxZoom = 28;
+static constexpr size_t ServeMaxConnections = 256; // more wait in the listen backlog
+
+// Tile z/x/y of the world square (half-width world.scale around the world
+// centre), x to the right and y down. Pixel centres sit at (i + 0.5) / size
+// across the tile, so neighbouring tiles meet without a shared column.
+static FractalParams tile_params(const FractalParams &world, int size, int z, int x, int y)
+{
+    FractalParams p = world;
+    const double span = 2.0 * world.scale / double(uint64_t(1) << z);
+    p.width = p.height = size;
+    p.frameWidth = p.frameHeight = 0;
+    p.originX = p.originY = 0;
+    p.centerX = world.centerX - world.scale + (x + 0.5) * span;
+    p.centerY = world.centerY + world.scale - (y + 0.5) * span;
+    p.centerXStr.clear();
+    p.centerYStr.clear();
+    p.scale = 0.5 * span * double(size - 1) / double(size);
+    return p;
+}
+
+using EncodedTile = std::shared_ptr<const std::vector<uint8_t>>;
+
+// Least recently used tiles are evicted once the encoded bytes exceed the
+// capacity (the newest tile always stays).
+class TileCache
+{
+public:
+    explicit TileCache(size_t capacityBytes) : capacity(capacityBytes) {}
+
+    EncodedTile get(uint64_t key)
+    {
+        std::lock_guard<std::mutex> lk(m);
+        auto it = index.find(key);
+        if (it == index.end())
+            return nullptr;
+        order.splice(order.begin(), order, it->second);
+        return it->second->second;
+    }
+
+    void put(uint64_t key, const EncodedTile &tile)
+    {
+        std::lock_guard<std::mutex> lk(m);
+        if (index.count(key))
+            return;
+        order.emplace_front(key, tile);
+        index[key] = order.begin();
+        bytes += tile->size();
+        while (bytes > capacity && order.size() > 1)
+        {
+            bytes -= order.back().second->size();
+            index.erase(order.back().first);
+            order.pop_back();
+            ++evictions;
+        }
+    }
+
+    void stats(size_t &tiles, size_t &used, uint64_t &evicted)
+    {
+        std::lock_guard<std::mutex> lk(m);
+        tiles = order.size();
+        used = bytes;
+        evicted = evictions;
+    }
+
+private:
+    std::mutex m;
+    std::list<std::pair<uint64_t, EncodedTile>> order; // most recent first
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, EncodedTile>>::iterator> index;
+    size_t capacity, bytes = 0;
+    uint64_t evictions = 0;
+};
+
+class TileService
+{
+public:
+    enum Source
+    {
+        Hit,
+        Coalesced,
+        Rendered,
+        SourceCount
+    };
+
+    explicit TileService(const Options &o)
+        : opt(o), cmap(make_colormap(o, o.palette)), cache(size_t(std::max(1, o.cacheMB)) << 20)
+    {
+        for (int i = 0; i < std::max(1, o.threads); ++i)
+            workers.emplace_back([this]()
+                                 { worker_main(); });
+    }
+
+    ~TileService()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    static uint64_t key(int z, int x, int y) { return (uint64_t(z) << 58) | (uint64_t(x) << 29) | uint64_t(y); }
+
+    EncodedTile get(int z, int x, int y, Source &src)
+    {
+        const uint64_t k = key(z, x, y);
+        src = Hit;
+        if (EncodedTile t = cache.get(k))
+            return t;
+        std::shared_future<EncodedTile> f;
+        {
+            std::lock_guard<std::mutex> lk(m);
+            auto it = inflight.find(k);
+            if (it != inflight.end())
+            {
+                src = Coalesced;
+                f = it->second;
+            }
+            else if (EncodedTile t = cache.get(k)) // finished since the first look
+                return t;
+            else
+            {
+                src = Rendered;
+                std::promise<EncodedTile> p;
+                f = p.get_future().share();
+                inflight.emplace(k, f);
+                jobs.emplace_back(k, std::move(p));
+                wake.notify_one();
+            }
+        }
+        return f.get();
+    }
+
+    // The latest LatencyWindow samples per source are kept for percentiles.
+    void record(Source src, double ms)
+    {
+        std::lock_guard<std::mutex> lk(statsMutex);
+        std::vector<double> &l = latencies[src];
+        if (l.size() < LatencyWindow)
+            l.push_back(ms);
+        else
+            l[counts[src] % LatencyWindow] = ms;
+        ++counts[src];
+    }
+
+    void write_stats(std::ostream &os)
+    {
+        size_t tiles, bytes;
+        uint64_t evictions;
+        cache.stats(tiles, bytes, evictions);
+        std::lock_guard<std::mutex> lk(statsMutex);
+        std::vector<double> all;
+        for (const auto &l : latencies)
+            all.insert(all.end(), l.begin(), l.end());
+        static const char *names[SourceCount] = {"hit", "coalesced", "rendered"};
+        os << "{\"requests\": " << counts[Hit] + counts[Coalesced] + counts[Rendered];
+        for (int s = 0; s < SourceCount; ++s)
+            os << ", \"" << names[s] << "\": " << counts[s];
+        os << ", \"cache_tiles\": " << tiles << ", \"cache_bytes\": " << bytes << ", \"evictions\": " << evictions
+           << ", \"p50_ms\": " << percentile(all, 0.50) << ", \"p99_ms\": " << percentile(all, 0.99);
+        for (int s = 0; s < SourceCount; ++s)
+        {
+            std::vector<double> v = latencies[s];
+            os << ", \"" << names[s] << "_p50_ms\": " << percentile(v, 0.50) << ", \"" << names[s]
+               << "_p99_ms\": " << percentile(v, 0.99);
+        }
+        os << "}\n";
+    }
+
+    const Options &opt;
+
+private:
+    ColorMap cmap;
+    TileCache cache;
+    std::mutex m;
+    std::condition_variable wake;
+    std::deque<std::pair<uint64_t, std::promise<EncodedTile>>> jobs;
+    std::unordered_map<uint64_t, std::shared_future<EncodedTile>> inflight;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+    static constexpr size_t LatencyWindow = size_t(1) << 20;
+    std::mutex statsMutex;
+    std::vector<double> latencies[SourceCount];
+    uint64_t counts[SourceCount] = {};
+
+    void worker_main()
+    {
+        const int size = std::max(1, opt.tileSize);
+        FractalParams view = tile_params(opt.p, size, 0, 0, 0);
+        CPURenderer r(view, cmap);
+        configure_renderer(r, opt);
+        ImageRGB img(size, size, true);
+        for (;;)
+        {
+            std::pair<uint64_t, std::promise<EncodedTile>> job;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                wake.wait(lk, [&]
+                          { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            const uint64_t k = job.first;
+            EncodedTile tile;
+            std::exception_ptr error;
+            try
+            {
+                view = tile_params(opt.p, size, int(k >> 58), int((k >> 29) & 0x1FFFFFFF), int(k & 0x1FFFFFFF));
+                r.retarget();
+                render_with(r, img, Backend::Serial, opt.mode, 1);
+                tile = std::make_shared<const std::vector<uint8_t>>(img.encode_bmp());
+                cache.put(k, tile);
+            }
+            catch (...)
+            {
+                error = std::current_exception(); // every waiter gets it, nothing is cached
+            }
+            {
+                std::lock_guard<std::mutex> lk(m);
+                inflight.erase(k);
+            }
+            if (error)
+                job.second.set_exception(error);
+            else
+                job.second.set_value(tile);
+        }
+    }
+};
+
+#ifdef HAVE_POSIX_SOCKETS
+static volatile std::sig_atomic_t serveStop = 0;
+
+static bool send_all(int fd, const void *data, size_t n)
+{
+    const char *p = (const char *)data;
+    while (n > 0)
+    {
+        ssize_t k = ::send(fd, p, n, 0);
+        if (k <= 0)
+            return false;
+        p += k;
+        n -= size_t(k);
+    }
+    return true;
+}
+
+static bool send_response(int fd, int status, const char *reason, const char *type, const void *body, size_t n,
+                          bool keepAlive)
+{
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\nContent-Type: " + type +
+                       "\r\nContent-Length: " + std::to_string(n) +
+                       (keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+    return send_all(fd, head.data(), head.size()) && send_all(fd, body, n);
 }
 
-static bool parse_opts(int argc, char **argv, Options &o)
+// One client connection: requests are handled in order until the client
+// closes, asks for Connection: close, or sends something malformed.
+static void serve_connection(TileService &svc, int fd)
+{
+    std::string buf;
+    char chunk[4096];
+    for (;;)
+    {
+        size_t end;
+        while ((end = buf.find("\r\n\r\n")) == std::string::npos)
+        {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0 || buf.size() > 16384)
+                return;
+            buf.append(chunk, size_t(n));
+        }
+        std::string head = buf.substr(0, end);
+        buf.erase(0, end + 4);
+        for (char &c : head)
+            c = (char)std::tolower((unsigned char)c); // header names and values are matched case-insensitively
+        Timer t;
+        t.start();
+
+        char method[8] = {}, target[256] = {};
+        int minor = 1;
+        if (std::sscanf(head.c_str(), "%7s %255s http/1.%d", method, target, &minor) < 2)
+            return;
+        bool keepAlive = minor >= 1 ? head.find("connection: close") == std::string::npos
+                                    : head.find("connection: keep-alive") != std::string::npos;
+        int z, x, y, used = 0;
+        bool ok = true;
+        if (std::string(method) != "get")
+        {
+            const char msg[] = "only GET is supported\n";
+            ok = send_response(fd, 405, "Method Not Allowed", "text/plain", msg, sizeof(msg) - 1, keepAlive);
+        }
+        else if (std::string(target) == "/stats")
+        {
+            std::ostringstream js;
+            svc.write_stats(js);
+            const std::string body = js.str();
+            ok = send_response(fd, 200, "OK", "application/json", body.data(), body.size(), keepAlive);
+        }
+        else if (std::sscanf(target, "/%d/%d/%d%n", &z, &x, &y, &used) == 3 &&
+                 (target[used] == '\0' || std::string(target + used) == ".bmp") && z >= 0 && z <= TileMaxZoom &&
+                 x >= 0 && y >= 0 && x < (1 << z) && y < (1 << z))
+        {
+            TileService::Source src;
+            EncodedTile tile;
+            try
+            {
+                tile = svc.get(z, x, y, src);
+            }
+            catch (const std::exception &)
+            {
+                const char msg[] = "tile render failed\n";
+                ok = send_response(fd, 500, "Internal Server Error", "text/plain", msg, sizeof(msg) - 1, keepAlive);
+            }
+            if (tile)
+            {
+                ok = send_response(fd, 200, "OK", "image/bmp", tile->data(), tile->size(), keepAlive);
+                svc.record(src, t.stop_ms());
+            }
+        }
+        else
+        {
+            const char msg[] = "expected /z/x/y.bmp or /stats\n";
+            ok = send_response(fd, 404, "Not Found", "text/plain", msg, sizeof(msg) - 1, keepAlive);
+        }
+        if (!ok || !keepAlive)
+            return;
+    }
+}
+
+static std::string listen_name(const Options &opt)
+{
+    return opt.socketPath.empty() ? opt.bindAddr + ":" + std::to_string(opt.port) : opt.socketPath;
+}
+
+static int open_listener(const Options &opt)
+{
+    int fd;
+    if (!opt.socketPath.empty())
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (opt.socketPath.size() >= sizeof(addr.sun_path))
+            return -1;
+        std::strcpy(addr.sun_path, opt.socketPath.c_str());
+        ::unlink(opt.socketPath.c_str());
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || ::bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+            return fd < 0 ? -1 : (::close(fd), -1);
+    }
+    else
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(opt.port));
+        if (::inet_pton(AF_INET, opt.bindAddr.c_str(), &addr.sin_addr) != 1)
+            return -1;
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        if (fd >= 0)
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (fd < 0 || ::bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+            return fd < 0 ? -1 : (::close(fd), -1);
+    }
+    if (::listen(fd, 128) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int run_serve(const Options &opt)
+{
+    const int listenFd = open_listener(opt);
+    if (listenFd < 0)
+    {
+        std::cerr << "Failed to listen on " << listen_name(opt) << "\n";
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, [](int)
+                { serveStop = 1; });
+    std::signal(SIGTERM, [](int)
+                { serveStop = 1; });
+
+    TileService svc(opt);
+    std::cout << "Serving " << opt.tileSize << "px tiles on "
+              << (opt.socketPath.empty() ? "http://" + listen_name(opt) : opt.socketPath)
+              << "/z/x/y.bmp with " << std::max(1, opt.threads) << " render worker(s), "
+              << std::max(1, opt.cacheMB) << " MB cache" << std::endl;
+
+    // connection threads are detached, at most ServeMaxConnections at once;
+    // open sockets are shut down on exit
+    std::mutex connMutex;
+    std::condition_variable connDone;
+    std::vector<int> open;
+    while (!serveStop)
+    {
+        {
+            std::unique_lock<std::mutex> lk(connMutex);
+            if (!connDone.wait_for(lk, std::chrono::milliseconds(200), [&]
+                                   { return open.size() < ServeMaxConnections; }))
+                continue;
+        }
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0)
+            continue;
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        std::lock_guard<std::mutex> lk(connMutex);
+        open.push_back(fd);
+        std::thread([&, fd]()
+                    {
+            serve_connection(svc, fd);
+            std::lock_guard<std::mutex> lk(connMutex);
+            open.erase(std::find(open.begin(), open.end(), fd));
+            ::close(fd);
+            connDone.notify_all(); })
+            .detach();
+    }
+    ::close(listenFd);
+    if (!opt.socketPath.empty())
+        ::unlink(opt.socketPath.c_str());
+    {
+        std::unique_lock<std::mutex> lk(connMutex);
+        for (int fd : open)
+            ::shutdown(fd, SHUT_RDWR);
+        connDone.wait(lk, [&]
+                      { return open.empty(); });
+    }
+    std::cout << "\nStats: ";
+    svc.write_stats(std::cout);
+    return 0;
+}
+#else
+static int run_serve(const Options &)
+{
+    std::cerr << "serve needs POSIX sockets\n";
+    return 1;
+}
+#endif
+
+// --------------------------- Distributed Rendering ---------------------------
+// `mandelbrot coordinate` splits the frame into --tile-size tiles for
+// `mandelbrot worker` processes, which connect over TCP or a Unix socket. A
+// worker is sent the coordinator's options once, then pulls one tile at a
+// time, renders it as a window of the frame with its own CPURenderer and
+// streams back the RGB pixels. Every worker connection has one coordinator
+// thread. The tile of a worker that disconnects or passes --worker-timeout
+// returns to the queue; once the queue is empty, idle workers get backup
+// copies of the longest-running tiles and the first result wins, so one slow
+// machine cannot hold up the end of the frame. Messages are in host byte
+// order: the processes are meant to run the same binary on one architecture.
+#ifdef HAVE_POSIX_SOCKETS
+enum DistType : uint32_t
+{
+    DistHello = 0x4D4F4D31, // worker: payload = name, id = DistVersion, w = threads
+    DistJob,                // coordinator: payload = options, '\0'-separated
+    DistTile,               // coordinator: render tile `id`
+    DistResult,             // worker: payload = RGB rows of tile `id`
+    DistDone                // coordinator: no more tiles
+};
+static constexpr uint32_t DistVersion = 1;
+
+struct DistMessage
+{
+    uint32_t type, id;
+    int32_t x0, y0, w, h;
+    uint64_t bytes;      // payload that follows
+    uint64_t iterations; // DistResult only
+};
+
+static bool recv_all(int fd, void *data, size_t n)
 {
-    for (int i = 1; i < argc; ++i)
+    char *p = (char *)data;
+    while (n > 0)
     {
-        std::string a = argv[i];
-        auto need = [&](int i)
-        { return (i + 1 < argc); };
-        if (a == "--help" || a == "-h")
-        {
-            print_help();
+        ssize_t k = ::recv(fd, p, n, 0);
+        if (k <= 0)
             return false;
-        }
-        else if (a == "--w" && need(i))
-            parse_int(argv[++i], o.p.width);
-        else if (a == "--h" && need(i))
-            parse_int(argv[++i], o.p.height);
-        else if (a == "--maxiter" && need(i))
-            parse_int(argv[++i], o.p.maxIter);
-        else if (a == "--cx" && need(i))
-            parse_double(argv[++i], o.p.centerX);
-        else if (a == "--cy" && need(i))
-            parse_double(argv[++i], o.p.centerY);
-        else if (a == "--scale" && need(i))
-            parse_double(argv[++i], o.p.scale);
-        else if (a == "--type" && need(i))
-            o.p.type = parse_type(argv[++i]);
-        else if (a == "--jre" && need(i))
-            parse_double(argv[++i], o.p.juliaRe);
-        else if (a == "--jim" && need(i))
-            parse_double(argv[++i], o.p.juliaIm);
-        else if (a == "--threads" && need(i))
-            parse_int(argv[++i], o.threads);
-        else if (a == "--backend" && need(i))
-            o.backend = parse_backend(argv[++i]);
-        else if (a == "--out" && need(i))
-            o.out = argv[++i];
-        else if (a == "--palette" && need(i))
-            o.palette = parse_palette(argv[++i]);
-        else if (a == "--colors" && need(i))
+        p += k;
+        n -= size_t(k);
+    }
+    return true;
+}
+
+static bool send_message(int fd, const DistMessage &m, const void *payload = nullptr)
+{
+    return send_all(fd, &m, sizeof(m)) && (m.bytes == 0 || send_all(fd, payload, m.bytes));
+}
+
+// Coordinator work queue. A tile is pending, running on up to MaxCopies
+// workers, or done; only the first result of a tile is kept.
+class TileScheduler
+{
+public:
+    static constexpr int MaxCopies = 2;
+
+    struct Tile
+    {
+        int x0, y0, w, h;
+        int copies = 0; // workers currently rendering it
+        bool done = false;
+        Timer started;
+    };
+    std::vector<Tile> tiles;
+    int backups = 0, wasted = 0, requeued = 0;
+    uint64_t iterations = 0;
+
+    TileScheduler(int width, int height, int size)
+    {
+        for (int y = 0; y < height; y += size)
+            for (int x = 0; x < width; x += size)
+                tiles.push_back({x, y, std::min(size, width - x), std::min(size, height - y), 0, false, Timer{}});
+        for (int id = 0; id < (int)tiles.size(); ++id)
+            pending.push_back(id);
+    }
+
+    // Blocks until there is a tile to render; -1 once every tile is done.
+    int take()
+    {
+        std::unique_lock<std::mutex> lk(m);
+        for (;;)
         {
-            std::vector<std::string> toks;
-            split_csv(argv[++i], toks);
-            o.colors.clear();
-            for (auto &t : toks)
+            if (doneCount == tiles.size() || stopping)
+                return -1;
+            if (!pending.empty())
             {
-                RGB c;
-                if (parse_hex_rgb(t, c))
-                    o.colors.push_back(c);
+                int id = pending.front();
+                pending.pop_front();
+                if (tiles[id].copies++ == 0)
+                    tiles[id].started.start();
+                return id;
             }
-            if (o.colors.empty())
-                std::cerr << "[warn] --colors parse failed; ignoring\n";
-        }
-        else if (a == "--widths" && need(i))
-        {
-            std::vector<std::string> toks;
-            split_csv(argv[++i], toks);
-            o.widths.clear();
-            for (auto &t : toks)
+            int best = -1;
+            for (int id = 0; id < (int)tiles.size(); ++id)
+                if (!tiles[id].done && tiles[id].copies > 0 && tiles[id].copies < MaxCopies &&
+                    (best < 0 || tiles[id].started.t0 < tiles[best].started.t0))
+                    best = id;
+            if (best >= 0)
             {
-                int v;
-                if (parse_int(t.c_str(), v))
-                    o.widths.push_back(v);
+                ++tiles[best].copies;
+                ++backups;
+                return best;
             }
+            wake.wait(lk);
         }
-        else if (a == "--feather" && need(i))
-            parse_double(argv[++i], o.feather);
-        else if (a == "--hue" && need(i))
-            parse_double(argv[++i], o.hue_off);
-        else if (a == "--sat" && need(i))
-            parse_double(argv[++i], o.sat);
-        else if (a == "--val" && need(i))
-            parse_double(argv[++i], o.val);
-        else
+    }
+
+    // True for the first result of the tile, which the caller then stores
+    // and reports with complete().
+    bool claim(int id)
+    {
+        std::lock_guard<std::mutex> lk(m);
+        --tiles[id].copies;
+        if (tiles[id].done)
         {
-            std::cerr << "Unknown or incomplete option: " << a << "\n";
-            print_help();
+            ++wasted;
             return false;
         }
+        tiles[id].done = true;
+        return true;
     }
-    o.p.width = std::max(1, o.p.width);
-    o.p.height = std::max(1, o.p.height);
-    o.p.maxIter = std::max(1, o.p.maxIter);
-    o.threads = std::max(1, o.threads);
-    return true;
-}
 
-// --------------------------- Main ---------------------------
-int main(int argc, char **argv)
-{
-    Options opt;
-    if (!parse_opts(argc, argv, opt))
-        return 0;
+    void complete(uint64_t iters)
+    {
+        std::lock_guard<std::mutex> lk(m);
+        iterations += iters;
+        if (++doneCount == tiles.size())
+            wake.notify_all();
+    }
 
-    std::unique_ptr<IFractal> f;
-    if (opt.p.type == FractalType::Mandelbrot)
+    // The worker is gone; the tile is queued again unless another copy runs.
+    void abandon(int id)
     {
-        f = std::make_unique<Mandelbrot>();
+        std::lock_guard<std::mutex> lk(m);
+        if (--tiles[id].copies == 0 && !tiles[id].done)
+        {
+            pending.push_front(id);
+            ++requeued;
+        }
+        wake.notify_all();
     }
-    else
+
+    bool finished()
     {
-        f = std::make_unique<Julia>(opt.p.juliaRe, opt.p.juliaIm);
+        std::lock_guard<std::mutex> lk(m);
+        return doneCount == tiles.size();
     }
 
-    ColorMap cmap;
-    cmap.type = opt.palette;
-    cmap.hue_offset = opt.hue_off;
-    cmap.sat_scale = opt.sat;
-    cmap.val_scale = opt.val;
-    cmap.feather = std::clamp(opt.feather, 0.0, 1.0);
+    void stop()
+    {
+        std::lock_guard<std::mutex> lk(m);
+        stopping = true;
+        wake.notify_all();
+    }
+
+private:
+    std::mutex m;
+    std::condition_variable wake;
+    std::deque<int> pending;
+    size_t doneCount = 0;
+    bool stopping = false;
+};
+
+struct DistWorkerStats
+{
+    std::string name;
+    int threads = 0;
+    int tiles = 0, wasted = 0;
+    double renderMs = 0.0; // from sending a tile to its result
+    bool lost = false;
+};
 
-    if (opt.palette == PaletteType::Gradient)
+// Serves one worker until the frame is done or the worker fails.
+static void coordinate_connection(TileScheduler &sched, ImageRGB &img, const std::string &job, const Options &opt,
+                                  int fd, DistWorkerStats &st)
+{
+    DistMessage hello;
+    std::vector<uint8_t> buf;
+    if (!recv_all(fd, &hello, sizeof(hello)) || hello.type != DistHello || hello.id != DistVersion || hello.bytes > 256)
+        return;
+    buf.resize(hello.bytes);
+    if (!recv_all(fd, buf.data(), buf.size()))
+        return;
+    st.name.assign(buf.begin(), buf.end());
+    st.threads = hello.w;
+    if (!send_message(fd, {DistJob, 0, 0, 0, 0, 0, job.size(), 0}, job.data()))
+        return;
+    if (opt.workerTimeout > 0)
     {
-        if (!opt.colors.empty())
-            cmap.stops = opt.colors;
-        else
-            cmap.stops = {{0, 0, 0}, {1, 1, 1}};
+        timeval tv{time_t(opt.workerTimeout), suseconds_t(std::fmod(opt.workerTimeout, 1.0) * 1e6)};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
     }
-    if (opt.palette == PaletteType::Banded)
+
+    for (int id; (id = sched.take()) >= 0;)
     {
-        cmap.stops = (!opt.colors.empty() ? opt.colors
-                                          : std::vector<RGB>{{1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {0, 1, 1}, {0, 0, 1}, {1, 0, 1}});
-        cmap.widths = opt.widths; // may be empty -> defaulted in colorize
+        const TileScheduler::Tile &t = sched.tiles[id];
+        const size_t bytes = size_t(t.w) * t.h * 3;
+        DistMessage res;
+        Timer timer;
+        timer.start();
+        bool ok = send_message(fd, {DistTile, uint32_t(id), t.x0, t.y0, t.w, t.h, 0, 0}) &&
+                  recv_all(fd, &res, sizeof(res)) && res.type == DistResult && res.id == uint32_t(id) &&
+                  res.bytes == bytes;
+        if (ok)
+        {
+            buf.resize(bytes);
+            ok = recv_all(fd, buf.data(), bytes);
+        }
+        if (!ok)
+        {
+            sched.abandon(id);
+            st.lost = !sched.finished(); // else cut off on a backup copy at the end
+            return;
+        }
+        st.renderMs += timer.stop_ms();
+        if (!sched.claim(id))
+        {
+            ++st.wasted;
+            continue;
+        }
+        for (int y = 0; y < t.h; ++y)
+            std::memcpy(img.pixel_ptr(t.x0, t.y0 + y), &buf[size_t(y) * t.w * 3], size_t(t.w) * 3);
+        sched.complete(res.iterations);
+        ++st.tiles;
     }
+    send_message(fd, {DistDone, 0, 0, 0, 0, 0, 0, 0});
+}
+
+static volatile std::sig_atomic_t coordinateStop = 0;
 
-    ImageRGB img_serial(opt.p.width, opt.p.height);
-    ImageRGB img_parallel(opt.p.width, opt.p.height);
+static int run_coordinate(const Options &opt, int argc, char **argv)
+{
+    const int W = opt.p.width, H = opt.p.height, size = std::max(16, opt.tileSize);
+    const int listenFd = open_listener(opt);
+    if (listenFd < 0)
+    {
+        std::cerr << "Failed to listen on " << listen_name(opt) << "\n";
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, [](int)
+                { coordinateStop = 1; });
+    std::signal(SIGTERM, [](int)
+                { coordinateStop = 1; });
 
-    CPURenderer renderer(*f, opt.p, cmap);
+    // workers parse the same options, so the frame is defined in one place
+    std::string job;
+    for (int i = 1; i < argc; ++i)
+        job.append(argv[i]).push_back('\0');
+    TileScheduler sched(W, H, size);
+    ImageRGB img(W, H);
+    std::cout << "Coordinating " << W << "x" << H << " in " << sched.tiles.size() << " tile(s) of " << size
+              << "px on " << listen_name(opt) << std::endl;
 
-    // Serial benchmark
+    std::mutex connMutex;
+    std::condition_variable connDone;
+    std::vector<int> open;
+    std::list<DistWorkerStats> workers;
     Timer t;
     t.start();
-    renderer.render_serial(img_serial);
-    double t_serial = t.stop_ms();
+    while (!coordinateStop && !sched.finished())
+    {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0)
+            continue;
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        std::lock_guard<std::mutex> lk(connMutex);
+        open.push_back(fd);
+        DistWorkerStats &st = workers.emplace_back();
+        std::thread([&, fd]()
+                    {
+            coordinate_connection(sched, img, job, opt, fd, st);
+            std::lock_guard<std::mutex> lk(connMutex);
+            open.erase(std::find(open.begin(), open.end(), fd));
+            ::close(fd);
+            connDone.notify_all(); })
+            .detach();
+    }
+    ::close(listenFd);
+    if (!opt.socketPath.empty())
+        ::unlink(opt.socketPath.c_str());
+    sched.stop();
+    {
+        // workers still on a backup copy of a finished tile are cut off
+        std::unique_lock<std::mutex> lk(connMutex);
+        for (int fd : open)
+            ::shutdown(fd, SHUT_RDWR);
+        connDone.wait(lk, [&]
+                      { return open.empty(); });
+    }
+    const double ms = t.stop_ms();
+    if (!sched.finished())
+    {
+        std::cerr << "Stopped before the frame was complete\n";
+        return 1;
+    }
 
-    // Parallel benchmark
-    double t_parallel = 0.0;
-    Backend backend_used = opt.backend;
+    const std::string &path = opt.out;
+    const bool tiff = path.size() > 4 && (path.substr(path.size() - 4) == ".tif" || path.substr(path.size() - 5) == ".tiff");
+    bool ok;
+    if (tiff)
+    {
+        BigTiffWriter out;
+        ok = out.open(path, W, H, size);
+        for (int y = 0; y < H && ok; y += size)
+            ok = out.write_strip(img.row_ptr(y), size_t(std::min(size, H - y)) * img.stride);
+        ok = ok && out.finish();
+    }
+    else
+        ok = save_image(img, path, opt.threads);
+    if (!ok)
+    {
+        std::cerr << "Failed to save: " << path << "\n";
+        return 1;
+    }
 
-    ImageRGB *outImg = &img_serial;
+    std::cout << "Resolution: " << W << "x" << H << " (distributed)\n";
+    std::cout << "Tiles:     " << sched.tiles.size() << " of " << size << "px, " << sched.requeued
+              << " requeued after a lost worker, " << sched.backups << " backup cop" << (sched.backups == 1 ? "y" : "ies")
+              << " (" << sched.wasted << " discarded)\n";
+    for (const DistWorkerStats &w : workers)
+        if (!w.name.empty())
+            std::cout << "Worker:    " << w.name << " (" << w.threads << " thread(s)): " << w.tiles << " tile(s), "
+                      << w.renderMs << " ms busy" << (w.lost ? ", lost" : "") << "\n";
+    std::cout << "Iterations: " << sched.iterations << "\n";
+    std::cout << "Output:    " << path << "\n";
+    std::cout << "Time:      " << ms << " ms (" << double(W) * H / (ms * 1e3) << " Mpix/s)\n";
+    return 0;
+}
 
-    if (opt.backend == Backend::Auto)
+// host:port over TCP, or the Unix socket path.
+static int connect_coordinator(const Options &opt)
+{
+    if (!opt.socketPath.empty())
     {
-#ifdef _OPENMP
-        backend_used = Backend::Omp;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (opt.socketPath.size() >= sizeof(addr.sun_path))
+            return -1;
+        std::strcpy(addr.sun_path, opt.socketPath.c_str());
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    const size_t colon = opt.connect.rfind(':');
+    const std::string host = colon == std::string::npos ? opt.connect : opt.connect.substr(0, colon);
+    const std::string port = colon == std::string::npos ? std::to_string(opt.port) : opt.connect.substr(colon + 1);
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_socktype = SOCK_STREAM;
+    if (::getaddrinfo(host.empty() ? "127.0.0.1" : host.c_str(), port.c_str(), &hints, &res) != 0)
+        return -1;
+    int fd = -1;
+    for (addrinfo *a = res; a && fd < 0; a = a->ai_next)
+    {
+        fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(res);
+    return fd;
+}
+
+static int run_worker(const Options &opt)
+{
+    if (opt.connect.empty() && opt.socketPath.empty())
+    {
+        std::cerr << "worker needs --connect <host:port> or --socket <path>\n";
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    int fd = -1;
+    for (int attempt = 0; attempt < 50 && (fd = connect_coordinator(opt)) < 0; ++attempt)
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // the coordinator may still be starting
+    if (fd < 0)
+    {
+        std::cerr << "Failed to connect to " << (opt.socketPath.empty() ? opt.connect : opt.socketPath) << "\n";
+        return 1;
+    }
+
+    char host[128] = "worker";
+    ::gethostname(host, sizeof(host) - 1);
+    const std::string name = std::string(host) + ":" + std::to_string(::getpid());
+    DistMessage m;
+    std::string args;
+    bool ok = send_message(fd, {DistHello, DistVersion, 0, 0, std::max(1, opt.threads), 0, name.size(), 0}, name.data()) &&
+              recv_all(fd, &m, sizeof(m)) && m.type == DistJob;
+    if (ok)
+    {
+        args.resize(m.bytes);
+        ok = recv_all(fd, args.data(), args.size());
+    }
+    if (!ok)
+    {
+        std::cerr << "No job from the coordinator\n";
+        ::close(fd);
+        return 1;
+    }
+
+    // the job's options with this machine's thread count and placement
+    std::vector<char *> argv{(char *)"worker"};
+    for (size_t i = 0; i < args.size(); i += std::strlen(&args[i]) + 1)
+        argv.push_back(&args[i]);
+    Options job;
+    parse_opts(int(argv.size()), argv.data(), job);
+    job.threads = opt.threads;
+    job.numa = opt.numa;
+
+    ColorMap cmap = make_colormap(job, job.palette);
+    const Backend backend = resolve_backend(job.backend);
+    FractalParams tp = job.p;
+    tp.frameWidth = job.p.width;
+    tp.frameHeight = job.p.height;
+    std::unique_ptr<CPURenderer> r;
+    std::unique_ptr<ImageRGB> img;
+    int tiles = 0;
+    Timer t;
+    t.start();
+    while (recv_all(fd, &m, sizeof(m)) && m.type == DistTile)
+    {
+        tp.originX = m.x0;
+        tp.originY = m.y0;
+        if (!r || tp.width != m.w || tp.height != m.h)
+        {
+            // edge tiles are smaller; anything else keeps the renderer
+            r.reset();
+            tp.width = m.w;
+            tp.height = m.h;
+            r = std::make_unique<CPURenderer>(tp, cmap);
+            configure_renderer(*r, job);
+            img = std::make_unique<ImageRGB>(m.w, m.h);
+        }
+        else
+            r->move_window();
+        render_with(*r, *img, backend, job.mode, job.threads);
+        if (!send_message(fd, {DistResult, m.id, m.x0, m.y0, m.w, m.h, img->data.size(), r->iterations.load()},
+                          img->data.data()))
+            break;
+        ++tiles;
+    }
+    ::close(fd);
+    std::cout << "Worker " << name << ": " << tiles << " tile(s) in " << t.stop_ms() << " ms\n";
+    return 0;
+}
 #else
-        backend_used = Backend::Threads;
+static int run_coordinate(const Options &, int, char **)
+{
+    std::cerr << "coordinate needs POSIX sockets\n";
+    return 1;
+}
+
+static int run_worker(const Options &)
+{
+    std::cerr << "worker needs POSIX sockets\n";
+    return 1;
+}
 #endif
+
+// --------------------------- Profile Report ---------------------------
+// JSON for --profile. Idle time is the iterate phase minus a thread's busy
+// time; imbalance is the busiest thread over the mean of all workers, and
+// efficiency the busy share of workers x iterate time (1 = no idling).
+static bool write_profile(const std::string &path, const Options &opt, const CPURenderer &r, Backend backend)
+{
+    std::ofstream file;
+    if (path != "-")
+    {
+        file.open(path);
+        if (!file)
+            return false;
+    }
+    std::ostream &js = path == "-" ? std::cout : file;
+    const RenderProfile &pr = *r.profile;
+    const double iterateMs = pr.phase_ms("iterate");
+    double maxBusy = 0.0, sumBusy = 0.0;
+    for (const ProfileThread &t : pr.threads)
+    {
+        maxBusy = std::max(maxBusy, t.busyMs);
+        sumBusy += t.busyMs;
     }
+    const double meanBusy = sumBusy / std::max(1, pr.workers);
+    std::vector<double> itemMs = pr.item_ms();
+    const double minMs = itemMs.empty() ? 0.0 : *std::min_element(itemMs.begin(), itemMs.end());
+    const double maxMs = itemMs.empty() ? 0.0 : *std::max_element(itemMs.begin(), itemMs.end());
 
-    if (backend_used == Backend::Serial)
+    js << "{\n  \"type\": \"" << fractal_name(opt.p) << "\",\n  \"width\": " << opt.p.width << ",\n  \"height\": "
+       << opt.p.height << ",\n  \"max_iter\": " << opt.p.maxIter << ",\n  \"backend\": \"" << backend_name(backend)
+       << (r.simd != SimdLevel::Scalar ? std::string("+") + simd_name(r.simd) : "") << (r.numaPlan ? "+numa" : "")
+       << "\",\n  \"mode\": \"" << mode_name(opt.mode) << "\",\n  \"threads\": " << pr.workers << ",\n  \"phases_ms\": {";
+    for (size_t i = 0; i < pr.phases.size(); ++i)
+        js << (i ? ", " : "") << "\"" << pr.phases[i].first << "\": " << pr.phases[i].second;
+    js << "},\n  \"iterations\": " << r.iterations.load() << ",\n  \"item_ms\": {\"count\": " << itemMs.size()
+       << ", \"min\": " << minMs << ", \"p50\": " << percentile(itemMs, 0.50) << ", \"p99\": "
+       << percentile(itemMs, 0.99) << ", \"max\": " << maxMs << "},\n  \"busy_ms\": {\"max\": " << maxBusy
+       << ", \"mean\": " << meanBusy << "},\n  \"imbalance\": " << (meanBusy > 0.0 ? maxBusy / meanBusy : 1.0)
+       << ",\n  \"efficiency\": " << (iterateMs > 0.0 ? sumBusy / (pr.workers * iterateMs) : 1.0)
+       << ",\n  \"per_thread\": [";
+    for (const ProfileThread &t : pr.threads)
+        js << (t.id ? "," : "") << "\n    {\"thread\": " << t.id << ", \"items\": " << t.items.size()
+           << ", \"iterations\": " << t.iterations << ", \"escaped\": " << t.escaped << ", \"interior\": "
+           << t.interior << ", \"busy_ms\": " << t.busyMs << ", \"idle_ms\": " << std::max(0.0, iterateMs - t.busyMs)
+           << "}";
+    js << "\n  ],\n  \"item_fields\": [\"x0\", \"y0\", \"x1\", \"y1\", \"thread\", \"ms\", \"iterations\"],\n"
+       << "  \"items\": [";
+    bool first = true;
+    for (const ProfileThread &t : pr.threads)
+        for (const ProfileItem &it : t.items)
+        {
+            js << (first ? "\n    [" : ",\n    [") << it.x0 << ", " << it.y0 << ", " << it.x1 << ", " << it.y1 << ", "
+               << it.thread << ", " << it.ms << ", " << it.iterations << "]";
+            first = false;
+        }
+    js << "\n  ]\n}\n";
+    return js.good();
+}
+
+// --------------------------- Main ---------------------------
+int main(int argc, char **argv)
+{
+    Options opt;
+    const std::string sub = argc > 1 ? argv[1] : "";
+    const bool bench = sub == "bench", serve = sub == "serve", coordinate = sub == "coordinate", worker = sub == "worker";
+    if (bench || serve || coordinate || worker)
     {
-        img_parallel = img_serial; // identical output already computed
-        t_parallel = t_serial;
-        outImg = &img_parallel;
+        --argc;
+        ++argv;
     }
-#ifdef _OPENMP
-    else if (backend_used == Backend::Omp)
+    if (!parse_opts(argc, argv, opt))
+        return 0;
+    if (bench)
+        return run_bench(opt);
+    if (serve)
+        return run_serve(opt);
+    if (coordinate)
+        return run_coordinate(opt, argc, argv);
+    if (worker)
+        return run_worker(opt);
+    if (!opt.pyramid.empty())
+        return run_pyramid(opt);
+    if (opt.outOfCore)
+        return run_out_of_core(opt);
+    if (!opt.animate.empty())
+        return run_animation(opt);
+
+    // --pan / --zoom start from the frame kept by --incremental
+    IterField last(opt.p.width, opt.p.height, opt.p.maxIter);
+    bool lastLoaded = false;
+    if (opt.panX || opt.panY || opt.zoomStep)
     {
-        t.start();
-        renderer.render_omp(img_parallel, opt.threads);
-        t_parallel = t.stop_ms();
-        outImg = &img_parallel;
+        if (opt.incremental.empty() || !(lastLoaded = load_field_state(opt.incremental, last)))
+        {
+            std::cerr << "--pan/--zoom need a last frame of this size in --incremental <file>\n";
+            return 1;
+        }
+        step_view(opt.p, last.view, opt.panX, opt.panY, opt.zoomStep);
     }
-#endif
-    else if (backend_used == Backend::Threads)
+
+    ColorMap cmap = make_colormap(opt, opt.palette);
+
+    ImageRGB img(opt.p.width, opt.p.height, opt.bmpNative, opt.numa);
+    CPURenderer renderer(opt.p, cmap);
+    configure_renderer(renderer, opt);
+    const Backend backend_used = resolve_backend(opt.backend);
+    if (!opt.profile.empty() || !opt.heatmap.empty())
+        renderer.profile = std::make_unique<RenderProfile>();
+
+    // One render with the chosen backend; `mandelbrot bench` does the timing studies.
+    // With --cache-dir an identical earlier render only needs colouring
+    // (unless profiling or saving distances, which need the render itself).
+    std::string cacheKey, cachePath, cacheNote;
+    if (!opt.cacheDir.empty())
     {
-        t.start();
-        renderer.render_threads(img_parallel, opt.threads);
-        t_parallel = t.stop_ms();
-        outImg = &img_parallel;
+        std::error_code ec;
+        std::filesystem::create_directories(opt.cacheDir, ec);
+        cacheKey = field_cache_key(renderer, opt.mode);
+        cachePath = field_cache_path(opt.cacheDir, cacheKey);
     }
+    Timer t;
+    t.start();
+    const bool cacheHit = !cachePath.empty() && !renderer.profile && opt.distanceOut.empty() &&
+                          load_cached_field(cachePath, cacheKey, renderer.field);
+    // With --incremental the last full frame seeds this one
+    renderer.incremental = !opt.incremental.empty();
+    if (lastLoaded && !cacheHit)
+        renderer.field = std::move(last);
+    const bool stateLoaded = renderer.incremental && !cacheHit &&
+                             (lastLoaded || load_field_state(opt.incremental, renderer.field));
+    size_t evaluated = 0;
+    if (cacheHit)
+        renderer.colorize(img, cmap, backend_used == Backend::Serial ? 1 : opt.threads);
     else
+        evaluated = render_with(renderer, img, backend_used, opt.mode, opt.threads);
+    double t_render = t.stop_ms();
+    if (cacheHit && (opt.mode == RenderMode::Full || opt.mode == RenderMode::Progressive))
+        renderer.keep_view();
+    std::string reuseNote;
+    if (renderer.incremental)
+    {
+        const double pixels = double(opt.p.width) * opt.p.height;
+        std::ostringstream n;
+        if (renderer.reuseKind)
+            n << renderer.reusedPixels << " of " << size_t(pixels) << " pixels (" << 100.0 * renderer.reusedPixels / pixels
+              << "%) from the last frame (" << renderer.reuseKind << ")";
+        else
+            n << (cacheHit                           ? "cache hit"
+                  : opt.mode != RenderMode::Full       ? std::string(mode_name(opt.mode)) + " mode"
+                  : stateLoaded                        ? "view does not overlap the last frame's grid"
+                                                       : "no last frame")
+              << ", nothing reused";
+        if (opt.panX || opt.panY || opt.zoomStep)
+        {
+            n.precision(17);
+            n << "; view --cx " << opt.p.centerX << " --cy " << opt.p.centerY << " --scale " << opt.p.scale;
+        }
+        if (renderer.field.family.empty())
+            n << "; " << opt.incremental << " not updated (not a complete full frame)";
+        else if (!store_field_state(opt.incremental, renderer.field))
+            n << "; could not write " << opt.incremental;
+        reuseNote = n.str();
+    }
+    if (cacheHit)
+        cacheNote = "hit, " + cachePath;
+    else if (!cachePath.empty() && opt.mode == RenderMode::Progressive && renderer.progressiveStep != 1)
+        cacheNote = "miss, not stored (stopped at deadline)";
+    else if (!cachePath.empty())
     {
-        // fallback
-        t_parallel = t_serial;
+        bool stored = store_cached_field(cachePath, cacheKey, renderer.field);
+        evict_field_cache(opt.cacheDir, uint64_t(std::max(0, opt.cacheMaxMB)) << 20);
+        cacheNote = stored ? "miss, stored " + cachePath : "miss, could not write " + cachePath;
     }
 
-    // Save final (parallel if used, otherwise serial)
-    if (!outImg->save_bmp(opt.out))
+    Timer ts;
+    ts.start();
+    if (!save_image(img, opt.out, backend_used == Backend::Serial ? 1 : opt.threads))
+    {
+        std::cerr << "Failed to save image: " << opt.out << "\n";
+        return 1;
+    }
+    const double t_save = ts.stop_ms();
+    if (!opt.distanceOut.empty())
+    {
+        if (!renderer.distanceKernel)
+            std::cerr << "No distance estimate for " << fractal_name(opt.p)
+                      << (renderer.deep ? " in deep zoom" : "") << "; " << opt.distanceOut << " not written\n";
+        else if (!save_pfm(opt.distanceOut, opt.p.width, opt.p.height, renderer.distance))
+        {
+            std::cerr << "Failed to save PFM: " << opt.distanceOut << "\n";
+            return 1;
+        }
+    }
+    if (!opt.profile.empty() && !write_profile(opt.profile, opt, renderer, backend_used))
     {
-        std::cerr << "Failed to save BMP: " << opt.out << "\n";
+        std::cerr << "Failed to write profile: " << opt.profile << "\n";
         return 1;
     }
+    if (!opt.heatmap.empty())
+    {
+        ImageRGB heat(opt.p.width, opt.p.height);
+        renderer.profile->heatmap(heat);
+        if (!save_image(heat, opt.heatmap, opt.threads))
+        {
+            std::cerr << "Failed to save image: " << opt.heatmap << "\n";
+            return 1;
+        }
+    }
 
-    // Report
-    auto b2str = [](Backend b)
+    // Re-color the kept iteration field; no fractal evaluation involved
+    std::vector<std::pair<std::string, double>> recolorTimes;
+    for (const auto &[palette, path] : opt.recolor)
     {
-        switch (b)
+        ColorMap cm = make_colormap(opt, palette);
+        t.start();
+        renderer.colorize(img, cm, backend_used == Backend::Serial ? 1 : opt.threads);
+        recolorTimes.emplace_back(path, t.stop_ms());
+        if (!save_image(img, path, backend_used == Backend::Serial ? 1 : opt.threads))
         {
-        case Backend::Auto:
-            return "auto";
-        case Backend::Omp:
-            return "OpenMP";
-        case Backend::Threads:
-            return "std::thread";
-        case Backend::Serial:
-            return "serial";
+            std::cerr << "Failed to save image: " << path << "\n";
+            return 1;
         }
-        return "unknown";
-    };
+    }
 
+    // Report
     std::cout << "Resolution: " << opt.p.width << "x" << opt.p.height << "\n";
     std::cout << "MaxIter:   " << opt.p.maxIter << "\n";
-    std::cout << "Type:      " << (opt.p.type == FractalType::Mandelbrot ? "Mandelbrot" : "Julia") << "\n";
+    std::cout << "Type:      " << fractal_name(opt.p) << "\n";
     if (opt.p.type == FractalType::Julia)
     {
         std::cout << "Julia c:   " << opt.p.juliaRe << " + " << opt.p.juliaIm << "i\n";
     }
-    std::cout << "Backend:   " << b2str(backend_used) << "\n";
-    std::cout << "Threads:   " << opt.threads << "\n";
-    std::cout << "Output:    " << opt.out << "\n\n";
-    std::cout << "Serial time:   " << t_serial << " ms\n";
-    std::cout << "Parallel time: " << t_parallel << " ms\n";
-    if (t_parallel > 0)
+    std::cout << "Backend:   " << backend_name(backend_used) << "\n";
+    std::cout << "Precision: " << (renderer.deep ? "double (perturbation)" : precision_name(renderer.tier)) << "\n";
+    if (opt.simd)
+        std::cout << "SIMD:      " << simd_name(renderer.simd) << " ("
+                  << simd_lanes(renderer.simd, renderer.tier == Precision::Float ? 4 : 8) << " lanes)\n";
+    if (!cacheNote.empty())
+        std::cout << "Cache:     " << cacheNote << "\n";
+    if (!reuseNote.empty())
+        std::cout << "Reuse:     " << reuseNote << "\n";
+    if (renderer.deep && !cacheHit)
+        std::cout << "Deep zoom: " << renderer.deep->precision_bits() << "-bit reference, "
+                  << renderer.deep->references << " reference(s), "
+                  << renderer.deep->glitchesLeft << " unresolved glitch pixel(s)\n";
+    if (renderer.deep && opt.p.series && !cacheHit)
+        std::cout << "Series:    skipped " << renderer.deep->primarySkip << " iteration(s) per pixel\n";
+    if (opt.mode == RenderMode::Progressive && !cacheHit)
+    {
+        const int step = renderer.progressiveStep;
+        std::cout << "Progressive: " << (step == 1 ? "complete" : "stopped at deadline") << ", finest full pass "
+                  << (step ? "1/" + std::to_string(step * step) + " resolution" : std::string("none")) << ", evaluated "
+                  << 100.0 * evaluated / (double(opt.p.width) * opt.p.height) << "% of pixels\n";
+    }
+    if (renderer.field.aaCount > 0)
+    {
+        const double pixels = double(opt.p.width) * opt.p.height, edges = double(renderer.field.aaPixel.size());
+        const int n = renderer.field.aaCount;
+        std::cout << "AA:        " << renderer.field.aaPixel.size() << " edge pixel(s) (" << 100.0 * edges / pixels
+                  << "%) x " << n << " samples, " << 100.0 * (pixels + edges * n) / (pixels * n)
+                  << "% of the cost of full supersampling\n";
+    }
+    if (renderer.numaPlan)
     {
-        std::cout << "Speedup:       " << (t_serial / t_parallel) << "x\n";
+        const NumaPlan &np = *renderer.numaPlan;
+        std::cout << "NUMA:      " << np.nodes() << " node(s), workers ";
+        for (int k = 0; k < np.nodes(); ++k)
+            std::cout << (k ? "+" : "") << np.firstWorker[k + 1] - np.firstWorker[k];
+        std::cout << (np.workers() > 0 && np.cpu[0] >= 0 ? " pinned" : " (not pinned: topology unknown)");
+        if (renderer.numaRemoteRows >= 0)
+            std::cout << ", " << renderer.numaRemoteRows << " row(s) rendered off-node";
+        std::cout << "\n";
     }
+    if (opt.mode == RenderMode::Mariani && !cacheHit)
+        std::cout << "Mariani:   evaluated " << evaluated << " of " << size_t(opt.p.width) * opt.p.height
+                  << " pixels (" << 100.0 * evaluated / (double(opt.p.width) * opt.p.height) << "%)\n";
+    if (opt.mode == RenderMode::Distance && !cacheHit)
+    {
+        if (!renderer.distanceKernel)
+            std::cout << "Distance:  no estimator for " << fractal_name(opt.p) << (renderer.deep ? " in deep zoom" : "")
+                      << ", rendered in full\n";
+        else
+            std::cout << "Distance:  evaluated " << evaluated << " of " << size_t(opt.p.width) * opt.p.height
+                      << " pixels (" << 100.0 * evaluated / (double(opt.p.width) * opt.p.height) << "%), "
+                      << renderer.distanceBlocks.load() << " block(s) filled from one evaluation\n";
+    }
+    if (!cacheHit)
+        std::cout << "Iterations: " << renderer.iterations.load() << " ("
+                  << double(renderer.iterations.load()) / (double(opt.p.width) * opt.p.height) << " per pixel)\n";
+    if (renderer.profile)
+    {
+        const RenderProfile &pr = *renderer.profile;
+        std::vector<double> itemMs = pr.item_ms();
+        double maxBusy = 0.0, sumBusy = 0.0;
+        for (const ProfileThread &th : pr.threads)
+        {
+            maxBusy = std::max(maxBusy, th.busyMs);
+            sumBusy += th.busyMs;
+        }
+        std::cout << "Profile:   " << itemMs.size() << " work item(s), p50 " << percentile(itemMs, 0.50) << " ms, p99 "
+                  << percentile(itemMs, 0.99) << " ms; busiest thread " << maxBusy << " ms vs mean "
+                  << sumBusy / std::max(1, pr.workers) << " ms\n";
+    }
+    if (backend_used == Backend::Pool && renderer.pool)
+        std::cout << "Tiles:     " << opt.tileW << "x" << opt.tileH << ", " << renderer.pool_steals() << " steal(s)\n";
+    std::cout << "Threads:   " << opt.threads << "\n";
+    std::error_code ec;
+    const uintmax_t outBytes = std::filesystem::file_size(opt.out, ec);
+    std::cout << "Output:    " << opt.out << " (" << (ec ? 0.0 : double(outBytes) / (1 << 20)) << " MB "
+              << (is_png_path(opt.out) ? "PNG" : "BMP") << ")\n\n";
+    std::cout << "Render time:   " << t_render << " ms\n";
+    std::cout << "Save time:     " << t_save << " ms\n";
+    for (const auto &[path, ms] : recolorTimes)
+        std::cout << "Recolor:       " << path << " in " << ms << " ms\n";
     return 0;
 }